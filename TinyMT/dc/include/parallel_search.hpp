@@ -0,0 +1,233 @@
+#ifndef PARALLEL_SEARCH_HPP
+#define PARALLEL_SEARCH_HPP
+/**
+ * @file parallel_search.hpp
+ *
+ * @brief search irreducible polynomials and temper the output on
+ * several threads, giving the results in the order of the serial search.
+ *
+ * The sequential numbers from \b start down to 0 are cut into chunks,
+ * and the chunks are handed to the threads in order. A thread tests
+ * every number of its chunk as Search does, tempers each generator
+ * found as all_in_one does, and keeps the results of the chunk. next()
+ * returns the results chunk by chunk, so that the generators come in
+ * the same order, with the same parameters, as from all_in_one.
+ *
+ * NTL must be built thread safe (NTL_THREADS, the default of NTL 11
+ * and later).
+ *
+ * The 3-clause BSD License is applied to this software, see
+ * LICENSE.txt
+ */
+
+#include <stdint.h>
+#include <pthread.h>
+#include <map>
+#include <vector>
+#include <NTL/GF2X.h>
+#include "sequential.hpp"
+#include "recursion_search.hpp"
+#include "random_util.hpp"
+#include "simple_shortest_basis.hpp"
+#include "search_temper.hpp"
+
+namespace tinymt {
+    /**
+     * @class parallel_search
+     * - search parameters of random number generator whose state transition
+     * function has an irreducible characteristic polynomial, on
+     * \b threads threads.
+     * - search tempering parameters for the generators.
+     *
+     * @tparam T type of generator's output, uint32_t or uint64_t.
+     * @tparam G class of generator, always linear_generator with template.
+     * @tparam ST tempering parameter searching strategy class.
+     * @tparam STLSB tempering paramete searching strategy class for
+     * tempering from LSB.
+     */
+    template<typename T, typename G, typename ST, typename STLSB>
+    class parallel_search {
+    public:
+        /**
+         * @class result
+         * a generator found by the search, with the values all_in_one
+         * gives by get_rand(), get_characteristic_polynomial(),
+         * get_weight() and get_delta().
+         */
+        class result {
+        public:
+            result(const G& ran) : rand(ran) {
+                weight = 0;
+                delta = 0;
+            }
+            G rand;
+            NTL::GF2X poly;
+            int weight;
+            int delta;
+        };
+
+        /**
+         * start the threads.
+         *
+         * @param ran generator with the id of the search.
+         * @param start the first sequential number, the search counts
+         * down to 0.
+         * @param threads number of threads.
+         * @param chunk_size sequential numbers a thread takes at once.
+         */
+        parallel_search(const G& ran, uint32_t start, int threads,
+                        int chunk_size = 128) :
+            proto(ran)
+            {
+                first = start;
+                chunk = chunk_size;
+                chunks = static_cast<uint64_t>(start) / chunk + 1;
+                next_chunk = 0;
+                wanted = 0;
+                current = NULL;
+                pos = 0;
+                stop = false;
+                ahead = 2 * threads;
+                pthread_mutex_init(&mutex, NULL);
+                pthread_cond_init(&chunk_done, NULL);
+                pthread_cond_init(&chunk_taken, NULL);
+                tids.resize(threads);
+                for (int i = 0; i < threads; i++) {
+                    pthread_create(&tids[i], NULL, thread_main, this);
+                }
+            }
+
+        /**
+         * stop and join the threads.
+         */
+        ~parallel_search() {
+            pthread_mutex_lock(&mutex);
+            stop = true;
+            pthread_cond_broadcast(&chunk_taken);
+            pthread_mutex_unlock(&mutex);
+            for (size_t i = 0; i < tids.size(); i++) {
+                pthread_join(tids[i], NULL);
+            }
+            typename std::map<uint64_t, std::vector<result> *>::iterator it;
+            for (it = done.begin(); it != done.end(); ++it) {
+                delete it->second;
+            }
+            delete current;
+            pthread_cond_destroy(&chunk_taken);
+            pthread_cond_destroy(&chunk_done);
+            pthread_mutex_destroy(&mutex);
+        }
+
+        /**
+         * get the next generator in the order of the serial search.
+         *
+         * @param res the generator found.
+         * @return false if the sequential numbers are exhausted.
+         */
+        bool next(result& res) {
+            pthread_mutex_lock(&mutex);
+            for (;;) {
+                if (current != NULL && pos < current->size()) {
+                    res = (*current)[pos++];
+                    pthread_mutex_unlock(&mutex);
+                    return true;
+                }
+                if (current != NULL) {
+                    delete current;
+                    current = NULL;
+                    wanted++;
+                    pthread_cond_broadcast(&chunk_taken);
+                }
+                if (wanted >= chunks) {
+                    pthread_mutex_unlock(&mutex);
+                    return false;
+                }
+                while (done.find(wanted) == done.end()) {
+                    pthread_cond_wait(&chunk_done, &mutex);
+                }
+                current = done[wanted];
+                done.erase(wanted);
+                pos = 0;
+            }
+        }
+    private:
+        static void *thread_main(void *arg) {
+            static_cast<parallel_search *>(arg)->work();
+            return NULL;
+        }
+
+        /**
+         * take chunks in order, at most \b ahead chunks past the one
+         * next() waits for, and search them.
+         */
+        void work() {
+            ST st;
+            STLSB stlsb;
+            pthread_mutex_lock(&mutex);
+            for (;;) {
+                while (!stop && next_chunk < chunks
+                       && next_chunk >= wanted + ahead) {
+                    pthread_cond_wait(&chunk_taken, &mutex);
+                }
+                if (stop || next_chunk >= chunks) {
+                    break;
+                }
+                uint64_t k = next_chunk++;
+                pthread_mutex_unlock(&mutex);
+                std::vector<result> *found = search_chunk(k, &st, &stlsb);
+                pthread_mutex_lock(&mutex);
+                done[k] = found;
+                pthread_cond_broadcast(&chunk_done);
+            }
+            pthread_mutex_unlock(&mutex);
+        }
+
+        /**
+         * search the sequential numbers of chunk \b k, as all_in_one does
+         * without verbose output.
+         */
+        std::vector<result> *search_chunk(uint64_t k, ST *st, STLSB *stlsb) {
+            using namespace MTToolBox;
+            uint32_t high = static_cast<uint32_t>(first - k * chunk);
+            int len = chunk;
+            if (high < static_cast<uint32_t>(chunk)) {
+                len = high + 1;
+            }
+            int veq[bit_size(T)];
+            std::vector<result> *found = new std::vector<result>;
+            Sequential<uint32_t> sq(0, high);
+            Search<G, Sequential<uint32_t> > s(proto, sq);
+            while (s.get_count() < len) {
+                if (!s.start(len - s.get_count())) {
+                    break;
+                }
+                result res(s.get_random());
+                res.poly = s.get_minpoly();
+                res.weight = NTL::weight(res.poly);
+                (*stlsb)(res.rand, false);
+                (*st)(res.rand, false);
+                shortest_basis<G, T> sc(res.rand, bit_size(T));
+                res.delta = sc.get_all_equidist(veq);
+                found->push_back(res);
+            }
+            return found;
+        }
+
+        G proto;
+        uint32_t first;
+        int chunk;
+        uint64_t chunks;
+        uint64_t next_chunk;
+        uint64_t wanted;
+        uint64_t ahead;
+        std::map<uint64_t, std::vector<result> *> done;
+        std::vector<result> *current;
+        size_t pos;
+        bool stop;
+        std::vector<pthread_t> tids;
+        pthread_mutex_t mutex;
+        pthread_cond_t chunk_done;
+        pthread_cond_t chunk_taken;
+    };
+}
+#endif
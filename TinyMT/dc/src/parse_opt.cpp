@@ -50,15 +50,17 @@ bool parse_opt(tinymt_options& opt, int argc, char **argv, uint32_t start) {
 	{"start", required_argument, NULL, 's'},
 	{"max", required_argument, NULL, 'm'},
 	{"count", required_argument, NULL, 'c'},
+	{"threads", required_argument, NULL, 't'},
 	{NULL, 0, NULL, 0}};
     opt.verbose = false;
     opt.count = 1;
     opt.max_delta = 10;
     opt.start = start;
     opt.all = false;
+    opt.threads = 1;
     errno = 0;
     for (;;) {
-	c = getopt_long(argc, argv, "vas:m:f:c:", longopts, NULL);
+	c = getopt_long(argc, argv, "vas:m:f:c:t:", longopts, NULL);
 	if (error) {
 	    break;
 	}
@@ -100,6 +102,13 @@ bool parse_opt(tinymt_options& opt, int argc, char **argv, uint32_t start) {
 		cerr << "count must be a number" << endl;
 	    }
 	    break;
+	case 't':
+	    opt.threads = strtol(optarg, NULL, 10);
+	    if (errno || opt.threads < 1) {
+		error = true;
+		cerr << "threads must be a positive number" << endl;
+	    }
+	    break;
 	case '?':
 	default:
 	    error = true;
@@ -143,7 +152,7 @@ static void output_help(string& pgm, uint32_t start) {
     cerr << "usage:" << endl;
     cerr << pgm
 	 << " [-v] [-c count] [-a] [-s start_pos] [-m max-delta]"
-	 << " [-f outputfile]"
+	 << " [-f outputfile] [-t threads]"
 	 << " id" << endl;
     static string help_string1 = "\n"
 "id                   ID of generator. the parameters searched with different\n"
@@ -159,6 +168,8 @@ static void output_help(string& pgm, uint32_t start) {
 "--max, -m max-delta  Search parameters whose total dimension defect is\n"
 "                     smaller than or equal to max-delta. if 0 is specified,\n"
 "                     search parameters for maximally equidistributed\n"
-"                     generators.";
+"                     generators.\n"
+"--threads, -t num    Search on num threads. Parameters are outputted in the\n"
+"                     same order as with one thread.";
     cerr << help_string1 << "0x" << hex << start << help_string2 << endl;
 }
@@ -32,6 +32,7 @@ public:
     long long count;
     uint32_t start;
     int max_delta;
+    int threads;
 };
 
 bool parse_opt(tinymt_options& opt, int argc, char **argv, uint32_t start);
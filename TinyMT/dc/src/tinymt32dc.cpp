@@ -28,6 +28,7 @@
 #include <fstream>
 #include <search_all.hpp>
 #include <sequential.hpp>
+#include <parallel_search.hpp>
 #include "tinymt32search.hpp"
 #include "parse_opt.h"
 #include "output.hpp"
@@ -40,6 +41,7 @@ static const uint32_t sequence_max = 0x7fffffff;
 typedef Sequential<uint32_t> Seq32;
 
 int search(tinymt_options& opt, int count);
+int search_parallel(tinymt_options& opt, int count);
 
 /**
  * parse command line option, and search parameters
@@ -54,6 +56,9 @@ int main(int argc, char** argv) {
 	return -1;
     }
     try {
+	if (opt.threads > 1) {
+	    return search_parallel(opt, opt.count);
+	}
 	return search(opt, opt.count);
     } catch (underflow_error e) {
 	return 0;
@@ -104,3 +109,44 @@ int search(tinymt_options& opt, int count) {
     }
     return 0;
 }
+
+/**
+ * search parameters on opt.threads threads using parallel_search in the
+ * file parallel_search.hpp. The parameters are the same, in the same
+ * order, as those of search().
+ * @param opt command line options
+ * @param count number of parameters user requested
+ * @return 0 if this ends normally
+ */
+int search_parallel(tinymt_options& opt, int count) {
+    tinymt32 g(opt.uid);
+
+    if (opt.verbose) {
+	time_t t = time(NULL);
+	cout << "search start at " << ctime(&t);
+	cout << "id:" << dec << opt.uid << endl;
+	cout << "threads:" << dec << opt.threads << endl;
+    }
+    parallel_search<uint32_t, tinymt32, st32, stlsb32>
+	all(g, opt.start, opt.threads);
+    parallel_search<uint32_t, tinymt32, st32, stlsb32>::result res(g);
+    int i = 0;
+    while (i < count || opt.all) {
+	if (!all.next(res)) {
+	    break;
+	}
+	if (res.delta > opt.max_delta) {
+	    continue;
+	}
+	tinymt32_param param = res.rand.get_param();
+	output_params<uint32_t, tinymt32_param>(res.poly, res.weight,
+						res.delta, param,
+						opt, i == 0);
+	i++;
+    }
+    if (opt.verbose) {
+	time_t t = time(NULL);
+	cout << "search end at " << ctime(&t) << endl;
+    }
+    return 0;
+}
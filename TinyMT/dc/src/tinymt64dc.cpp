@@ -28,6 +28,7 @@
 #include <fstream>
 #include <search_all.hpp>
 #include <sequential.hpp>
+#include <parallel_search.hpp>
 #include "tinymt64search.hpp"
 #include "parse_opt.h"
 #include "output.hpp"
@@ -40,6 +41,7 @@ typedef Sequential<uint32_t> Seq32;
 static const uint32_t sequence_max = 0xffffffff;
 
 int search(tinymt_options& opt, int count);
+int search_parallel(tinymt_options& opt, int count);
 
 int main(int argc, char** argv) {
     tinymt_options opt;
@@ -48,6 +50,9 @@ int main(int argc, char** argv) {
 	return -1;
     }
     try {
+	if (opt.threads > 1) {
+	    return search_parallel(opt, opt.count);
+	}
 	return search(opt, opt.count);
     } catch (underflow_error e) {
 	return 0;
@@ -87,3 +92,31 @@ int search(tinymt_options& opt, int count) {
     }
     return 0;
 }
+
+int search_parallel(tinymt_options& opt, int count) {
+    tinymt64 g(opt.uid);
+
+    if (opt.verbose) {
+	time_t t = time(NULL);
+	cout << "search start at " << ctime(&t);
+	cout << "id:" << dec << opt.uid << endl;
+	cout << "threads:" << dec << opt.threads << endl;
+    }
+    parallel_search<uint64_t, tinymt64, st64, stlsb64>
+	all(g, opt.start, opt.threads);
+    parallel_search<uint64_t, tinymt64, st64, stlsb64>::result res(g);
+    for (int i = 0; i < count; i++) {
+	if (!all.next(res)) {
+	    break;
+	}
+	tinymt64_param param = res.rand.get_param();
+	output_params<uint64_t, tinymt64_param>(res.poly, res.weight,
+						res.delta, param, opt,
+						i == 0);
+    }
+    if (opt.verbose) {
+	time_t t = time(NULL);
+	cout << "search end at " << ctime(&t);
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file calc_jump_table.c
+ *
+ * @brief generates a jump table for sequential ids of tinymt32 streams
+ *
+ * Entry i of the table is the jump polynomial of stride * 2<sup>i</sup>
+ * steps, so that jumping by the entries of the set bits of an id moves a
+ * generator id * stride steps ahead: stream id starts there and has
+ * stride numbers of its own. calc_jump_poly.cpp computes the 32 entries
+ * of tinymt32_jump_table.clh (stride 3<sup>40</sup>) with NTL; this tool
+ * computes any stride and up to 64 entries with f2-polynomial.c.
+ *
+ * The table is written as a header that compiles both as OpenCL C, for
+ * tinymt32j_jump_by_table, and as C, for tinymt32_jump_by_table. Its
+ * MAX_ID is the largest id whose stream ends before the period
+ * 2<sup>127</sup>-1, so that ids up to it never overlap.
+ *
+ * The 3-clause BSD License is applied to this software, see
+ * LICENSE.txt
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include "f2-polynomial.h"
+
+#define MAX_ENTRIES 64
+
+static void usage(const char * prog);
+static void upper_case(char * dest, const char * src, size_t size);
+
+static void usage(const char * prog)
+{
+    printf("usage:\n%s [-s stride] [-n entries] [-p name] polynomial\n",
+	   prog);
+    printf("  -s stride  steps between sequential ids "
+	   "(default 3^40 = 12157665459056928801)\n");
+    printf("  -n entries table entries, ids below 2^entries "
+	   "(default %d, at most %d)\n", MAX_ENTRIES, MAX_ENTRIES);
+    printf("  -p name    name of the table (default tinymt32_jump_table64)\n");
+}
+
+static void upper_case(char * dest, const char * src, size_t size)
+{
+    size_t i;
+    for (i = 0; i + 1 < size && src[i] != 0; i++) {
+	dest[i] = (char)toupper((unsigned char)src[i]);
+    }
+    dest[i] = 0;
+}
+
+int main(int argc, char * argv[]) {
+    uint64_t stride = UINT64_C(12157665459056928801);
+    int entries = MAX_ENTRIES;
+    const char * name = "tinymt32_jump_table64";
+    const char * poly_str = NULL;
+    char upper[128];
+    f2_polynomial jump;
+
+    for (int i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+	    stride = strtoull(argv[++i], NULL, 0);
+	} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+	    entries = atoi(argv[++i]);
+	} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+	    name = argv[++i];
+	} else if (argv[i][0] == '-') {
+	    usage(argv[0]);
+	    return -1;
+	} else {
+	    poly_str = argv[i];
+	}
+    }
+    if (poly_str == NULL || stride == 0
+	|| entries < 1 || entries > MAX_ENTRIES) {
+	usage(argv[0]);
+	return -1;
+    }
+    upper_case(upper, name, sizeof(upper));
+
+    /* ids 0 .. max_id, stream id covers [id * stride, (id + 1) * stride) */
+    unsigned __int128 period = ((unsigned __int128)1 << 127) - 1;
+    unsigned __int128 max_id = period / stride - 1;
+    uint64_t id_limit = (entries == 64) ? UINT64_MAX
+	: (UINT64_C(1) << entries) - 1;
+    if (max_id > id_limit) {
+	max_id = id_limit;
+    }
+
+    printf("#ifndef %s_H\n#define %s_H\n", upper, upper);
+    printf("/*\n");
+    printf(" * jump table of tinymt32 for sequential ids, generated by\n");
+    printf(" * calc_jump_table -s %" PRIu64 " -n %d -p %s %s\n",
+	   stride, entries, name, poly_str);
+    printf(" * entry i jumps %" PRIu64 " * 2^i steps; ids up to %s_MAX_ID\n",
+	   stride, upper);
+    printf(" * never overlap.\n");
+    printf(" */\n");
+    printf("#if !defined(TINYMT32_JUMP_TABLE_TYPES)\n");
+    printf("#define TINYMT32_JUMP_TABLE_TYPES\n");
+    printf("#if defined(__OPENCL_VERSION__)\n");
+    printf("#define TINYMT32_JUMP_TABLE_CONST __constant\n");
+    printf("#define TINYMT32_JUMP_TABLE_U32 uint\n");
+    printf("#define TINYMT32_JUMP_TABLE_U64(x) x##UL\n");
+    printf("#else\n");
+    printf("#include <stdint.h>\n");
+    printf("#define TINYMT32_JUMP_TABLE_CONST static const\n");
+    printf("#define TINYMT32_JUMP_TABLE_U32 uint32_t\n");
+    printf("#define TINYMT32_JUMP_TABLE_U64(x) UINT64_C(x)\n");
+    printf("#endif\n");
+    printf("#endif\n\n");
+    printf("#define %s_SIZE %d\n", upper, entries);
+    printf("#define %s_STEP TINYMT32_JUMP_TABLE_U64(%" PRIu64 ")\n",
+	   upper, stride);
+    printf("#define %s_MAX_ID TINYMT32_JUMP_TABLE_U64(%" PRIu64 ")\n\n",
+	   upper, (uint64_t)max_id);
+    printf("TINYMT32_JUMP_TABLE_CONST TINYMT32_JUMP_TABLE_U32\n");
+    printf("%s[%s_SIZE][4] = {\n", name, upper);
+    for (int i = 0; i < entries; i++) {
+	/* stride * 2^i as a 128-bit step */
+	unsigned __int128 step = (unsigned __int128)stride << i;
+	calculate_jump_polynomial(&jump, (uint64_t)step,
+				  (uint64_t)(step >> 64), poly_str);
+	printf("    {0x%08" PRIx32 ",0x%08" PRIx32 ",0x%08" PRIx32
+	       ",0x%08" PRIx32 "}%s\n",
+	       (uint32_t)jump.ar[0], (uint32_t)(jump.ar[0] >> 32),
+	       (uint32_t)jump.ar[1], (uint32_t)(jump.ar[1] >> 32),
+	       (i + 1 < entries) ? "," : "");
+    }
+    printf("};\n#endif\n");
+    return 0;
+}
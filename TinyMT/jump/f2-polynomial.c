@@ -26,6 +26,19 @@
 #include <errno.h>
 #include <string.h>
 
+/*
+ * Carry-less multiply (PCLMULQDQ) path of polynomial_power_mod, compiled
+ * for x86 with gcc or clang and chosen at run time when the CPU has the
+ * instruction; define F2_POLYNOMIAL_NO_CLMUL to leave it out.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__)) \
+    && !defined(F2_POLYNOMIAL_NO_CLMUL)
+#define F2_POLYNOMIAL_CLMUL 1
+#include <wmmintrin.h>
+#define CLMUL_TARGET __attribute__((target("pclmul,sse2")))
+#endif
+
 /**
  * This structure represents polynomial over F<sub>2</sub> of
  * degree less than 256.
@@ -123,11 +136,11 @@ inline static void shiftdown_lpol1(lpol *dest) {
  * @param n number of shift up
  */
 inline static void shiftup_lpoln(lpol * dest, int n) {
-    if (n <= 64) {
+    if (n < 64) {
 	shiftup_lpol_n0(dest, n);
-    } else if (n <= 128) {
+    } else if (n < 128) {
 	shiftup_lpol_n1(dest, n);
-    } else if (n <= 192) {
+    } else if (n < 192) {
 	shiftup_lpol_n2(dest, n);
     } else {
 	shiftup_lpol_n3(dest, n);
@@ -135,7 +148,7 @@ inline static void shiftup_lpoln(lpol * dest, int n) {
 }
 
 /**
- * subcontract function: n < =64
+ * subcontract function: 0 < n < 64
  * shift up n bit, ifindeterminate of dest is <b>t</b>
  * dest = dest * <b>t</b><sup>n</sup>
  * @param dest 256-bit polynomial
@@ -152,7 +165,7 @@ inline static void shiftup_lpol_n0(lpol *dest, int n) {
 }
 
 /**
- * subcontract function: 64 < n <= 128
+ * subcontract function: 64 <= n < 128
  * shift up n bit, ifindeterminate of dest is <b>t</b>
  * dest = dest * <b>t</b><sup>n</sup>
  * @param dest 256-bit polynomial
@@ -160,8 +173,9 @@ inline static void shiftup_lpol_n0(lpol *dest, int n) {
  */
 inline static void shiftup_lpol_n1(lpol *dest, int n) {
     n -= 64;
-    uint64_t msb0 = dest->ar[0] >> (64 - n);
-    uint64_t msb1 = dest->ar[1] >> (64 - n);
+    /* shift by 64 is undefined: n == 0 is a pure word shift */
+    uint64_t msb0 = (n == 0) ? 0 : dest->ar[0] >> (64 - n);
+    uint64_t msb1 = (n == 0) ? 0 : dest->ar[1] >> (64 - n);
     dest->ar[3] = (dest->ar[2] << n) | msb1;
     dest->ar[2] = (dest->ar[1] << n) | msb0;
     dest->ar[1] = (dest->ar[0] << n);
@@ -169,7 +183,7 @@ inline static void shiftup_lpol_n1(lpol *dest, int n) {
 }
 
 /**
- * subcontract function: 128 < n <= 192
+ * subcontract function: 128 <= n < 192
  * shift up n bit, ifindeterminate of dest is <b>t</b>
  * dest = dest * <b>t</b><sup>n</sup>
  * @param dest 256-bit polynomial
@@ -177,7 +191,7 @@ inline static void shiftup_lpol_n1(lpol *dest, int n) {
  */
 inline static void shiftup_lpol_n2(lpol *dest, int n) {
     n -= 128;
-    uint64_t msb0 = dest->ar[0] >> (64 - n);
+    uint64_t msb0 = (n == 0) ? 0 : dest->ar[0] >> (64 - n);
     dest->ar[3] = (dest->ar[1] << n) | msb0;
     dest->ar[2] = (dest->ar[0] << n);
     dest->ar[1] = 0;
@@ -185,7 +199,7 @@ inline static void shiftup_lpol_n2(lpol *dest, int n) {
 }
 
 /**
- * subcontract function: 192 < n <= 256
+ * subcontract function: 192 <= n < 256
  * shift up n bit, ifindeterminate of dest is <b>t</b>
  * dest = dest * <b>t</b><sup>n</sup>
  * @param dest 256-bit polynomial
@@ -373,6 +387,178 @@ void polynomialtostr(char * str, const f2_polynomial * poly)
 	    poly->ar[0]);
 }
 
+#if defined(F2_POLYNOMIAL_CLMUL)
+/**
+ * 1 if polynomial_power_mod uses carry-less multiplication, 0 if not,
+ * -1 before the CPU is checked.
+ */
+static int use_clmul = -1;
+
+/**
+ * shift down n bit, 0 <= n < 256
+ * dest = dest / <b>t</b><sup>n</sup>, remainder discarded
+ * @param dest 256-bit polynomial
+ * @param n number of shift down
+ */
+inline static void shiftdown_lpoln(lpol * dest, int n) {
+    int words = n / 64;
+    int bits = n % 64;
+
+    for (int i = 0; i < 4; i++) {
+	uint64_t lo = (i + words < 4) ? dest->ar[i + words] : 0;
+	uint64_t hi = (i + words + 1 < 4) ? dest->ar[i + words + 1] : 0;
+	dest->ar[i] = (bits == 0) ? lo : (lo >> bits) | (hi << (64 - bits));
+    }
+}
+
+/**
+ * multiplication of polynomials of degree less than 128 by PCLMULQDQ,
+ * the four 64 x 64 bit products of the schoolbook method<br>
+ * dest = x * y
+ * @param dest 256-bit polynomial
+ * @param x polynomial, ar[0] and ar[1] used
+ * @param y polynomial, ar[0] and ar[1] used
+ */
+CLMUL_TARGET inline static void clmul_lpol(lpol * dest, const lpol * x,
+					   const lpol * y) {
+    __m128i a = _mm_loadu_si128((const __m128i *)x->ar);
+    __m128i b = _mm_loadu_si128((const __m128i *)y->ar);
+    __m128i lo = _mm_clmulepi64_si128(a, b, 0x00);
+    __m128i hi = _mm_clmulepi64_si128(a, b, 0x11);
+    __m128i mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x01),
+				_mm_clmulepi64_si128(a, b, 0x10));
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+    _mm_storeu_si128((__m128i *)&dest->ar[0], lo);
+    _mm_storeu_si128((__m128i *)&dest->ar[2], hi);
+}
+
+/**
+ * square of a polynomial of degree less than 128 by PCLMULQDQ;
+ * the cross products cancel over F<sub>2</sub><br>
+ * x = x * x
+ * @param x polynomial
+ */
+CLMUL_TARGET inline static void clsquare_lpol(lpol * x) {
+    __m128i a = _mm_loadu_si128((const __m128i *)x->ar);
+    _mm_storeu_si128((__m128i *)&x->ar[0], _mm_clmulepi64_si128(a, a, 0x00));
+    _mm_storeu_si128((__m128i *)&x->ar[2], _mm_clmulepi64_si128(a, a, 0x11));
+}
+
+/**
+ * divisor and its Barrett constant mu = <b>t</b><sup>2d</sup> / mod,
+ * d the degree of mod, 0 < d < 128
+ */
+struct BARRETT_T {
+    lpol mod;
+    lpol mu;
+    int deg;
+};
+
+typedef struct BARRETT_T barrett;
+
+/**
+ * set up Barrett reduction modulo mod by long division of
+ * <b>t</b><sup>2d</sup>
+ * @param b Barrett constants
+ * @param mod divisor, 0 < degree < 128
+ */
+static void barrett_init(barrett * b, const lpol * mod) {
+    lpol rem;
+    lpol tmp;
+    int deg = deg_lpol(mod);
+
+    b->mod = *mod;
+    b->deg = deg;
+    clear_lpol(&b->mu);
+    clear_lpol(&rem);
+    rem.ar[(2 * deg) / 64] = UINT64_C(1) << ((2 * deg) % 64);
+    for (int i = deg; i >= 0; i--) {
+	if ((rem.ar[(i + deg) / 64] >> ((i + deg) % 64)) & 1) {
+	    tmp = *mod;
+	    shiftup_lpoln(&tmp, i);
+	    add_lpol(&rem, &tmp);
+	    b->mu.ar[i / 64] |= UINT64_C(1) << (i % 64);
+	}
+    }
+}
+
+/**
+ * remainder by Barrett reduction, exact over F<sub>2</sub>:
+ * q = ((x / <b>t</b><sup>d</sup>) * mu) / <b>t</b><sup>d</sup>
+ * is the quotient x / mod<br>
+ * x = x % mod, degree of x less than 2d
+ * @param x polynomial to be divided and remainder
+ * @param b Barrett constants
+ */
+CLMUL_TARGET inline static void barrett_lpol(lpol * x, const barrett * b) {
+    lpol q;
+    lpol qm;
+
+    q = *x;
+    shiftdown_lpoln(&q, b->deg);
+    clmul_lpol(&qm, &q, &b->mu);
+    shiftdown_lpoln(&qm, b->deg);
+    clmul_lpol(&q, &qm, &b->mod);
+    add_lpol(x, &q);
+}
+
+/**
+ * dest = x<sup>power</sup> % mod by carry-less multiplication and
+ * Barrett reduction; see polynomial_power_mod.
+ */
+CLMUL_TARGET static void power_mod_clmul(f2_polynomial * dest,
+					 const f2_polynomial * x,
+					 uint64_t lower_power,
+					 uint64_t upper_power,
+					 const lpol * lmod) {
+    barrett b;
+    lpol tmp;
+    lpol result;
+    uint64_t power[2] = {lower_power, upper_power};
+
+    barrett_init(&b, lmod);
+    tolpol(&tmp, x);
+    mod_lpol(&tmp, lmod);
+    clear_lpol(&result);
+    result.ar[0] = 1;
+    for (int w = 0; w < 2; w++) {
+	/* all 64 bits of the lower word when the upper one follows */
+	int n = (w == 0 && power[1] != 0) ? 64 : 0;
+	uint64_t p = power[w];
+	for (int i = 0; p != 0 || i < n; i++, p >>= 1) {
+	    if ((p & 1) != 0) {
+		clmul_lpol(&result, &result, &tmp);
+		barrett_lpol(&result, &b);
+	    }
+	    clsquare_lpol(&tmp);
+	    barrett_lpol(&tmp, &b);
+	}
+    }
+    topol(dest, &result);
+}
+#endif
+
+/**
+ * selects the arithmetic of polynomial_power_mod. By default it uses
+ * carry-less multiplication (PCLMULQDQ) when the CPU has it, and the
+ * bit-serial code otherwise.
+ * @param enable 0 to force the bit-serial code, 1 to use PCLMULQDQ when
+ * available
+ * @return 1 if PCLMULQDQ is used from now on, else 0
+ */
+int polynomial_use_clmul(int enable)
+{
+#if defined(F2_POLYNOMIAL_CLMUL)
+    __builtin_cpu_init();
+    use_clmul = enable && __builtin_cpu_supports("pclmul");
+    return use_clmul;
+#else
+    (void)enable;
+    return 0;
+#endif
+}
+
 /**
  * dest = x<sup>power</sup> % mod
  * @param dest the result of calculation
@@ -393,8 +579,17 @@ void polynomial_power_mod(f2_polynomial * dest,
     lpol * result = & result_z;
     lpol lmod_z;
     lpol * lmod = &lmod_z;
-    tolpol(tmp, x);
     tolpol(lmod, mod);
+#if defined(F2_POLYNOMIAL_CLMUL)
+    if (use_clmul < 0) {
+	polynomial_use_clmul(1);
+    }
+    if (use_clmul && deg_lpol(lmod) > 0) {
+	power_mod_clmul(dest, x, lower_power, upper_power, lmod);
+	return;
+    }
+#endif
+    tolpol(tmp, x);
     clear_lpol(result);
     result_z.ar[0] = 1;
     for (int i = 0; i < 64; i++) {
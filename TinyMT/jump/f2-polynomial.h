@@ -43,6 +43,7 @@ void polynomial_power_mod(f2_polynomial * dest,
 			  uint64_t lower_power,
 			  uint64_t upper_power,
 			  const f2_polynomial * mod);
+int polynomial_use_clmul(int enable);
 void calculate_jump_polynomial(f2_polynomial *jump_poly,
 			       uint64_t lower_step,
 			       uint64_t upper_step,
@@ -98,3 +98,30 @@ void tinymt32_jump_by_polynomial(tinymt32_t *tiny,
     }
     *tiny = *work;
 }
+
+/**
+ * jump to the stream of a sequential id with a table generated by
+ * calc_jump_table: entry i jumps stride * 2<sup>i</sup> steps, so the
+ * entries of the set bits of id jump id * stride steps.
+ * @param tiny tinymt32 structure, overwritten by new state after calling
+ * this function.
+ * @param table jump table, e.g. tinymt32_jump_table64
+ * @param size number of entries of table
+ * @param id sequential id, below 2<sup>size</sup>
+ */
+void tinymt32_jump_by_table(tinymt32_t *tiny,
+			    const uint32_t (*table)[4],
+			    int size,
+			    uint64_t id)
+{
+    f2_polynomial jump_poly;
+
+    for (int i = 0; (id != 0) && (i < size); i++) {
+	if ((id & 1) != 0) {
+	    jump_poly.ar[0] = table[i][0] | ((uint64_t)table[i][1] << 32);
+	    jump_poly.ar[1] = table[i][2] | ((uint64_t)table[i][3] << 32);
+	    tinymt32_jump_by_polynomial(tiny, &jump_poly);
+	}
+	id = id >> 1;
+    }
+}
@@ -14,6 +14,10 @@ void tinymt32_jump(tinymt32_t *tiny,
 		   const char * poly_str);
 void tinymt32_jump_by_polynomial(tinymt32_t *tiny,
 				 f2_polynomial * jump_poly);
+void tinymt32_jump_by_table(tinymt32_t *tiny,
+			    const uint32_t (*table)[4],
+			    int size,
+			    uint64_t id);
 
 #if defined(__cplusplus)
 }
@@ -33,18 +33,42 @@ int main(int argc, char *argv[]) {
     upper_step = strtoull(argv[2], NULL, 10);
     printf("jump step is %"PRIu64"x 2^{64} + %"PRIu64"steps\n",
 	   upper_step, lower_step);
-    start = clock();
-    for (i = 0; i < repeat; i++) {
-	tinymt32_calculate_jump_polynomial(&jump_poly,
-					   lower_step,
-					   upper_step,
-					   poly);
+    /* bit-serial and carry-less multiply arithmetic must agree */
+    f2_polynomial clmul_poly;
+    int clmul = polynomial_use_clmul(1);
+    int ng = 0;
+    srand(1);
+    for (i = 0; i < 1000 && clmul; i++) {
+	uint64_t lo = ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ rand();
+	uint64_t up = (i % 2) ? ((uint64_t)rand() << 31) ^ rand() : 0;
+	polynomial_use_clmul(0);
+	calculate_jump_polynomial(&jump_poly, lo, up, poly);
+	polynomial_use_clmul(1);
+	calculate_jump_polynomial(&clmul_poly, lo, up, poly);
+	if (jump_poly.ar[0] != clmul_poly.ar[0]
+	    || jump_poly.ar[1] != clmul_poly.ar[1]) {
+	    ng = 1;
+	}
+    }
+    if (clmul) {
+	printf("bit-serial and PCLMULQDQ polynomials %s\n", ng ? "NG!" : "OK!");
+    }
+    for (int c = 0; c <= clmul; c++) {
+	polynomial_use_clmul(c);
+	start = clock();
+	for (i = 0; i < repeat; i++) {
+	    calculate_jump_polynomial(&jump_poly,
+					       lower_step,
+					       upper_step,
+					       poly);
+	}
+	finish = clock();
+	elapsed = finish - start;
+	elapsed = 1000 * elapsed / CLOCKS_PER_SEC;
+	elapsed = elapsed / repeat;
+	printf("calculate polynomial time (%s) = %f ms\n",
+	       c ? "PCLMULQDQ" : "bit-serial", elapsed);
     }
-    finish = clock();
-    elapsed = finish - start;
-    elapsed = 1000 * elapsed / CLOCKS_PER_SEC;
-    elapsed = elapsed / repeat;
-    printf("calculate polynomial time = %f ms\n", elapsed);
     start = clock();
     for (i = 0; i < repeat; i++) {
 	tinymt32_jump_by_polynomial(&tiny, &jump_poly);
@@ -54,5 +78,5 @@ int main(int argc, char *argv[]) {
     elapsed = 1000 * elapsed / CLOCKS_PER_SEC;
     elapsed = elapsed / repeat;
     printf("jump time = %f ms\n", elapsed);
-    return 0;
+    return ng;
 }
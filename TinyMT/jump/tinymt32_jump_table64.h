@@ -0,0 +1,94 @@
+#ifndef TINYMT32_JUMP_TABLE64_H
+#define TINYMT32_JUMP_TABLE64_H
+/*
+ * jump table of tinymt32 for sequential ids, generated by
+ * calc_jump_table -s 12157665459056928801 -n 64 -p tinymt32_jump_table64 d8524022ed8dff4a8dcc50c798faba43
+ * entry i jumps 12157665459056928801 * 2^i steps; ids up to TINYMT32_JUMP_TABLE64_MAX_ID
+ * never overlap.
+ */
+#if !defined(TINYMT32_JUMP_TABLE_TYPES)
+#define TINYMT32_JUMP_TABLE_TYPES
+#if defined(__OPENCL_VERSION__)
+#define TINYMT32_JUMP_TABLE_CONST __constant
+#define TINYMT32_JUMP_TABLE_U32 uint
+#define TINYMT32_JUMP_TABLE_U64(x) x##UL
+#else
+#include <stdint.h>
+#define TINYMT32_JUMP_TABLE_CONST static const
+#define TINYMT32_JUMP_TABLE_U32 uint32_t
+#define TINYMT32_JUMP_TABLE_U64(x) UINT64_C(x)
+#endif
+#endif
+
+#define TINYMT32_JUMP_TABLE64_SIZE 64
+#define TINYMT32_JUMP_TABLE64_STEP TINYMT32_JUMP_TABLE_U64(12157665459056928801)
+#define TINYMT32_JUMP_TABLE64_MAX_ID TINYMT32_JUMP_TABLE_U64(13994560389365007133)
+
+TINYMT32_JUMP_TABLE_CONST TINYMT32_JUMP_TABLE_U32
+tinymt32_jump_table64[TINYMT32_JUMP_TABLE64_SIZE][4] = {
+    {0x4ef38e31,0xca64cb3e,0x58005925,0x50029072},
+    {0x0db944dd,0xb5baf1a6,0x11190368,0x002e97f0},
+    {0xac90fcc3,0x459849d2,0xa66f183f,0x51fa5216},
+    {0x69e67e51,0xf16d8493,0x82a09356,0x6854e55d},
+    {0xf647e755,0xcdface1f,0xda3b0222,0x590aebea},
+    {0xd8c552ac,0xd4c99de1,0x5534a0d9,0x41e11626},
+    {0x86d67c2c,0x7e4a30e9,0xe1cc666c,0x52c8d38d},
+    {0x61c6371f,0xf7538850,0x00728662,0x0259f94f},
+    {0x23f0f107,0x0d890068,0x1ba19dc9,0x654f5b29},
+    {0x7aa1c52d,0x7bdabfce,0x68d36eb2,0x5c2fb73c},
+    {0x223a1358,0x444e55c9,0xb8f9fceb,0x593a625c},
+    {0x249949e2,0xf28a13f6,0x5770bc89,0x0d45e674},
+    {0xa7347dc3,0x559bd9e0,0x9a21b9b1,0x574421e1},
+    {0xc4565686,0xd9824575,0x278853b4,0x72ed8cde},
+    {0x3553d677,0xb9721d05,0x79a24b89,0x56df35e9},
+    {0x87d3a7e1,0xddcbc4ff,0xc413f22d,0x1a2f250d},
+    {0xb7d5f3f0,0xfbf8abcb,0xb5cf72a0,0x22015702},
+    {0xf8077f95,0x7f16d6eb,0x23574b64,0x5c06e4be},
+    {0xbad2b02e,0xfccb2a6a,0xef9ab3c5,0x3441b10a},
+    {0x9bb621ce,0xd59cb9c8,0x58870bb0,0x6273cdc4},
+    {0x423514ef,0x88755f9e,0xa932d1f3,0x094ff35e},
+    {0x77fcffdf,0xc6a1a5a3,0x4a3f4192,0x6f94cc6f},
+    {0x175f1173,0x3f2e3836,0x606d1d5f,0x2c359461},
+    {0xd2301c4a,0x87ae0696,0xcc5ff77f,0x21979d7a},
+    {0xa3b01770,0x4c42e38a,0xefa5843c,0x509e623c},
+    {0x8edd0470,0x5c110e0a,0x2dea653a,0x46cbfaea},
+    {0x56c8b55b,0x21c4ae8d,0x3b70a522,0x2ddb453e},
+    {0x2b3a0aba,0xd305e144,0x50907d57,0x0286e815},
+    {0x88122803,0xec45f4cc,0x6201768d,0x592031bb},
+    {0xbb30e1f1,0x34e35800,0xbed567bb,0x6872608f},
+    {0x354be8b4,0x9475189a,0x1d657fd4,0x5761dc09},
+    {0x82fc046e,0x97fd9c61,0x37cae8de,0x1c377678},
+    {0x352dd4cb,0x91949bab,0x749d17bb,0x58a243f0},
+    {0x806e4514,0x11f543aa,0xe545b933,0x4beea7e5},
+    {0xe6f15134,0x2106d578,0x5415bb61,0x73dac8fd},
+    {0xfa94f95f,0xb9fb6c5f,0x7dbb9f7d,0x7c76ae28},
+    {0xc4a1163d,0xbd6bd053,0x880a1a8b,0x0b7121a7},
+    {0xc017e002,0x052152be,0x4563f972,0x5a18159d},
+    {0x0ef13727,0x5c605103,0x22acf9e6,0x02d8867b},
+    {0xc59bc0db,0x4861d768,0xf2c171fa,0x21229444},
+    {0x657f01e8,0xab84e217,0xf53441ba,0x58f2de1a},
+    {0xb7bc69f1,0x439b0207,0xd13ccaf2,0x7b604d9e},
+    {0x3798f6e3,0x1df24b63,0x0572f7e8,0x0c7f3462},
+    {0x23bf3104,0x079a7419,0xbd82b474,0x60989dbe},
+    {0x02f8555b,0x70d97fc0,0x137bb5fd,0x67ebed12},
+    {0x1b2fc9f4,0x6438ea66,0xdf3b8556,0x0e46266d},
+    {0x015e8547,0xf95e118c,0x68b7cb18,0x01c7139c},
+    {0x86d09eae,0x34904a37,0x3bfccfc0,0x4ab3bc36},
+    {0x201f7482,0x2842bcaf,0x1ab9602d,0x313f99c8},
+    {0xa4e0839b,0x86111080,0x514eb987,0x55cfc726},
+    {0x21cca997,0x6ed8677d,0x5ef090a4,0x2d725c1f},
+    {0x79a66416,0x90c16f22,0x4ba749b7,0x0a714c1c},
+    {0x1f6a2c02,0x6849f858,0x86ceab5e,0x2a42ba7e},
+    {0xc50d284a,0x3d11e677,0xe5c1aa49,0x2cddd3b6},
+    {0xc81bcaa7,0x8950d69e,0x242a900b,0x0a0bf4bc},
+    {0xb1e45048,0xa764483c,0x709ea79d,0x4409a120},
+    {0xa4a2defd,0x7a600c9e,0x7b4021ff,0x3c2c0026},
+    {0x4a06368e,0x04c03a07,0xa939298f,0x199e5c15},
+    {0x41bedeff,0x423d9513,0x1e58224d,0x11bb6a22},
+    {0xba675281,0x67a056ae,0x634183c2,0x0b898f02},
+    {0x48965a64,0xc38f432c,0xe6abbade,0x19c07867},
+    {0xd6c238c3,0xf59da09e,0xb5410616,0x5429aff0},
+    {0x74e7b96c,0x53dac6a8,0x16348230,0x4dad325e},
+    {0x9fe8ee3d,0x6d2a3d75,0xd70a676b,0x05219a99}
+};
+#endif
@@ -0,0 +1,117 @@
+/**
+ * @file check32xN.c
+ *
+ * @brief Check program for tinymt32xN: prints the output of check32 as
+ * lane LANE produces it
+ *
+ * Lane LANE is seeded as check32 seeds its generator, every other lane
+ * l with seed + 1 + l, so the output equals check32.out.txt only if the
+ * lane runs as tinymt32 does and independently of its neighbours.
+ *
+ * The 3-clause BSD License is applied to this software, see
+ * LICENSE.txt
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include "tinymt32xN.h"
+
+#define ROWS 10
+#define COLS 5
+#define COUNT (ROWS * COLS)
+
+int main(int argc, char * argv[]) {
+    if (argc < 4) {
+	printf("%s mat1 mat2 tmat [seed [lane]]\n", argv[0]);
+	return -1;
+    }
+    tinymt32_t params[TINYMT32XN_N];
+    uint32_t seeds[TINYMT32XN_N];
+    tinymt32xN_t tinymt;
+    int seed = 1;
+    int lane = 0;
+    static uint32_t u[COUNT * TINYMT32XN_N];
+    static float f[COUNT * TINYMT32XN_N];
+    float fN[TINYMT32XN_N];
+    double dN[TINYMT32XN_N];
+
+    if (argc >= 5) {
+	seed = strtol(argv[4], NULL, 0);
+    }
+    if (argc >= 6) {
+	lane = atoi(argv[5]);
+    }
+    if (lane < 0 || lane >= TINYMT32XN_N) {
+	printf("lane must be in 0..%d\n", TINYMT32XN_N - 1);
+	return -1;
+    }
+    for (int l = 0; l < TINYMT32XN_N; l++) {
+	params[l].mat1 = strtoul(argv[1], NULL, 16);
+	params[l].mat2 = strtoul(argv[2], NULL, 16);
+	params[l].tmat = strtoul(argv[3], NULL, 16);
+	seeds[l] = (l == lane) ? (uint32_t)seed : (uint32_t)(seed + 1 + l);
+    }
+    printf("tinymt32 0x%08"PRIx32, params[lane].mat1);
+    printf(" 0x%08"PRIx32, params[lane].mat2);
+    printf(" 0x%08"PRIx32, params[lane].tmat);
+    printf(" seed = %d\n", seed);
+    tinymt32xN_init(&tinymt, params, seeds);
+    printf("32-bit unsigned integers r, where 0 <= r < 2^32\n");
+    tinymt32xN_fill_array_uint32(&tinymt, u, COUNT * TINYMT32XN_N);
+    for (int i = 0; i < ROWS; i++) {
+	for (int j = 0; j < COLS; j++) {
+	    printf("%10"PRIu32" ", u[(i * COLS + j) * TINYMT32XN_N + lane]);
+	}
+	printf("\n");
+    }
+    printf("init_by_array {%d}\n", seed);
+    for (int l = 0; l < TINYMT32XN_N; l++) {
+	tinymt32_t s = params[l];
+	tinymt32_init_by_array(&s, &seeds[l], 1);
+	tinymt32xN_set_lane(&tinymt, l, &s);
+    }
+    printf("float numbers r, where 0.0 <= r < 1.0\n");
+    tinymt32xN_fill_array_float(&tinymt, f, COUNT * TINYMT32XN_N);
+    for (int i = 0; i < ROWS; i++) {
+	for (int j = 0; j < COLS; j++) {
+	    printf("%.7f ", f[(i * COLS + j) * TINYMT32XN_N + lane]);
+	}
+	printf("\n");
+    }
+    printf("float numbers r, where 1.0 <= r < 2.0\n");
+    for (int i = 0; i < ROWS; i++) {
+	for (int j = 0; j < COLS; j++) {
+	    tinymt32xN_generate_float12(&tinymt, fN);
+	    printf("%.7f ", fN[lane]);
+	}
+	printf("\n");
+    }
+
+    printf("float numbers r, where 0.0 < r <= 1.0\n");
+    tinymt32xN_fill_array_floatOC(&tinymt, f, COUNT * TINYMT32XN_N);
+    for (int i = 0; i < ROWS; i++) {
+	for (int j = 0; j < COLS; j++) {
+	    printf("%.7f ", f[(i * COLS + j) * TINYMT32XN_N + lane]);
+	}
+	printf("\n");
+    }
+
+    printf("float numbers r, where 0.0 < r < 1.0\n");
+    for (int i = 0; i < ROWS; i++) {
+	for (int j = 0; j < COLS; j++) {
+	    tinymt32xN_generate_floatOO(&tinymt, fN);
+	    printf("%.7f ", fN[lane]);
+	}
+	printf("\n");
+    }
+
+    printf("32-bit precision double numbers r, where 0.0 <= r < 1.0\n");
+    for (int i = 0; i < ROWS; i++) {
+	for (int j = 0; j < COLS; j++) {
+	    tinymt32xN_generate_32double(&tinymt, dN);
+	    printf("%.7f ", dN[lane]);
+	}
+	printf("\n");
+    }
+}
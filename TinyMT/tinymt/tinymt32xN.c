@@ -0,0 +1,130 @@
+/**
+ * @file tinymt32xN.c
+ *
+ * @brief N tinymt32 generators stepped together in SIMD registers
+ *
+ * Initialization and bulk generation of tinymt32xN_t; see tinymt32xN.h.
+ *
+ * The 3-clause BSD License is applied to this software, see
+ * LICENSE.txt
+ */
+#include <assert.h>
+#include "tinymt32xN.h"
+
+/**
+ * This function initializes every lane with tinymt32_init.
+ * @param random tinymt32xN state vector.
+ * @param params N tinymt32 parameter sets (mat1, mat2 and tmat), one
+ * per lane.
+ * @param seed N 32-bit unsigned integer seeds, one per lane.
+ */
+void tinymt32xN_init(tinymt32xN_t * random, const tinymt32_t * params,
+                     const uint32_t seed[]) {
+    tinymt32_t lane;
+
+    for (int l = 0; l < TINYMT32XN_N; l++) {
+        lane.mat1 = params[l].mat1;
+        lane.mat2 = params[l].mat2;
+        lane.tmat = params[l].tmat;
+        tinymt32_init(&lane, seed[l]);
+        tinymt32xN_set_lane(random, l, &lane);
+    }
+}
+
+/**
+ * This function sets one lane to a tinymt32 state and its parameters,
+ * e.g. one initialized by tinymt32_init_by_array or jumped ahead.
+ * @param random tinymt32xN state vector.
+ * @param lane lane, 0 <= lane < TINYMT32XN_N
+ * @param state tinymt32 state vector.
+ */
+void tinymt32xN_set_lane(tinymt32xN_t * random, int lane,
+                         const tinymt32_t * state) {
+    for (int i = 0; i < 4; i++) {
+        random->status[i][lane] = state->status[i];
+    }
+    random->mat1[lane] = state->mat1;
+    random->mat2[lane] = state->mat2;
+    random->tmat[lane] = state->tmat;
+}
+
+/**
+ * This function copies one lane out as a tinymt32 state.
+ * @param random tinymt32xN state vector.
+ * @param lane lane, 0 <= lane < TINYMT32XN_N
+ * @param state tinymt32 state vector.
+ */
+void tinymt32xN_get_lane(const tinymt32xN_t * random, int lane,
+                         tinymt32_t * state) {
+    for (int i = 0; i < 4; i++) {
+        state->status[i] = random->status[i][lane];
+    }
+    state->mat1 = random->mat1[lane];
+    state->mat2 = random->mat2[lane];
+    state->tmat = random->tmat[lane];
+}
+
+/**
+ * This function fills an array with 32-bit unsigned integers, size / N
+ * per lane, array[k * N + l] the k-th of lane l. The state stays in
+ * registers for the whole array.
+ * @param random tinymt32xN state vector.
+ * @param array output array.
+ * @param size number of outputs, a multiple of TINYMT32XN_N.
+ */
+void tinymt32xN_fill_array_uint32(tinymt32xN_t * random, uint32_t array[],
+                                  size_t size) {
+    tinymt32xN_regs_t regs;
+
+    assert(size % TINYMT32XN_N == 0);
+    tinymt32xN_load_regs(random, &regs);
+    for (size_t k = 0; k < size; k += TINYMT32XN_N) {
+        tinymt32xN_next_regs(&regs);
+        tinymt32xN_store(&array[k], tinymt32xN_temper_regs(&regs));
+    }
+    tinymt32xN_store_regs(random, &regs);
+}
+
+/**
+ * This function fills an array with floating point numbers r
+ * (0.0 <= r < 1.0), laid out as in tinymt32xN_fill_array_uint32.
+ * @param random tinymt32xN state vector.
+ * @param array output array.
+ * @param size number of outputs, a multiple of TINYMT32XN_N.
+ */
+void tinymt32xN_fill_array_float(tinymt32xN_t * random, float array[],
+                                 size_t size) {
+    tinymt32xN_regs_t regs;
+
+    assert(size % TINYMT32XN_N == 0);
+    tinymt32xN_load_regs(random, &regs);
+    for (size_t k = 0; k < size; k += TINYMT32XN_N) {
+        tinymt32xN_next_regs(&regs);
+        tinymt32xN_storef(&array[k],
+                          tinymt32xN_to_float(tinymt32xN_temper_regs(&regs)));
+    }
+    tinymt32xN_store_regs(random, &regs);
+}
+
+/**
+ * This function fills an array with floating point numbers r
+ * (0.0 < r <= 1.0), laid out as in tinymt32xN_fill_array_uint32. Lane l
+ * gets the numbers of repeated tinymt32_generate_floatOC calls.
+ * @param random tinymt32xN state vector.
+ * @param array output array.
+ * @param size number of outputs, a multiple of TINYMT32XN_N.
+ */
+void tinymt32xN_fill_array_floatOC(tinymt32xN_t * random, float array[],
+                                   size_t size) {
+    tinymt32xN_regs_t regs;
+
+    assert(size % TINYMT32XN_N == 0);
+    tinymt32xN_load_regs(random, &regs);
+    for (size_t k = 0; k < size; k += TINYMT32XN_N) {
+        tinymt32xN_next_regs(&regs);
+        tinymt32xN_next_regs(&regs);
+        tinymt32xN_storef(&array[k], tinymt32xN_rsubf(1.0f,
+            tinymt32xN_to_float(tinymt32xN_temper_regs(&regs))));
+    }
+    tinymt32xN_store_regs(random, &regs);
+}
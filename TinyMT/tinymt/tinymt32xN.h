@@ -0,0 +1,505 @@
+#ifndef TINYMT32XN_H
+#define TINYMT32XN_H
+/**
+ * @file tinymt32xN.h
+ *
+ * @brief N independent tinymt32 generators stepped together in SIMD
+ * registers
+ *
+ * The N states are kept in SoA form, status word i of lane l in
+ * status[i][l], so that one vector operation advances every lane. Each
+ * lane has its own parameters and produces exactly the sequence of a
+ * tinymt32_t with the same state and parameters.
+ *
+ * N is TINYMT32XN_N: 16 with AVX-512F, 8 with AVX2 and 4 otherwise,
+ * unless defined on the command line. N = 16, 8 and 4 use AVX-512F, AVX2
+ * and SSE2 instructions; other values, or TINYMT32XN_GENERIC, use plain C
+ * loops over the lanes.
+ *
+ * The generate functions write one number per lane. The fill_array
+ * functions write size / N numbers per lane, interleaved: array[k * N + l]
+ * is the k-th number of lane l.
+ */
+
+#include <stddef.h>
+#include "tinymt32.h"
+
+#if !defined(TINYMT32XN_N)
+#if defined(__AVX512F__)
+#define TINYMT32XN_N 16
+#elif defined(__AVX2__)
+#define TINYMT32XN_N 8
+#else
+#define TINYMT32XN_N 4
+#endif
+#endif
+
+#if !defined(TINYMT32XN_GENERIC)
+#if TINYMT32XN_N == 16 && defined(__AVX512F__)
+#define TINYMT32XN_AVX512
+#elif TINYMT32XN_N == 8 && defined(__AVX2__)
+#define TINYMT32XN_AVX2
+#elif TINYMT32XN_N == 4 && defined(__SSE2__)
+#define TINYMT32XN_SSE2
+#else
+#define TINYMT32XN_GENERIC
+#endif
+#endif
+
+#if defined(TINYMT32XN_AVX512) || defined(TINYMT32XN_AVX2)
+#include <immintrin.h>
+#elif defined(TINYMT32XN_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * N tinymt32 internal state vectors and parameters, lane l in
+ * column l
+ */
+struct TINYMT32XN_T {
+    uint32_t status[4][TINYMT32XN_N];
+    uint32_t mat1[TINYMT32XN_N];
+    uint32_t mat2[TINYMT32XN_N];
+    uint32_t tmat[TINYMT32XN_N];
+};
+
+typedef struct TINYMT32XN_T tinymt32xN_t;
+
+void tinymt32xN_init(tinymt32xN_t * random, const tinymt32_t * params,
+                     const uint32_t seed[]);
+void tinymt32xN_set_lane(tinymt32xN_t * random, int lane,
+                         const tinymt32_t * state);
+void tinymt32xN_get_lane(const tinymt32xN_t * random, int lane,
+                         tinymt32_t * state);
+void tinymt32xN_fill_array_uint32(tinymt32xN_t * random, uint32_t array[],
+                                  size_t size);
+void tinymt32xN_fill_array_float(tinymt32xN_t * random, float array[],
+                                 size_t size);
+void tinymt32xN_fill_array_floatOC(tinymt32xN_t * random, float array[],
+                                   size_t size);
+
+/*
+ * vector of N 32-bit lanes and the operations the generator needs
+ */
+#if defined(TINYMT32XN_AVX512)
+typedef __m512i tinymt32xN_v;
+typedef __m512 tinymt32xN_vf;
+inline static tinymt32xN_v tinymt32xN_load(const uint32_t * p) {
+    return _mm512_loadu_si512(p);
+}
+inline static void tinymt32xN_store(uint32_t * p, tinymt32xN_v a) {
+    _mm512_storeu_si512(p, a);
+}
+inline static void tinymt32xN_storef(float * p, tinymt32xN_vf a) {
+    _mm512_storeu_ps(p, a);
+}
+inline static tinymt32xN_v tinymt32xN_set1(uint32_t a) {
+    return _mm512_set1_epi32((int)a);
+}
+inline static tinymt32xN_v tinymt32xN_and(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm512_and_si512(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_or(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm512_or_si512(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_xor(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm512_xor_si512(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_add(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm512_add_epi32(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_sub(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm512_sub_epi32(a, b);
+}
+#define tinymt32xN_sll(a, n) _mm512_slli_epi32(a, n)
+#define tinymt32xN_srl(a, n) _mm512_srli_epi32(a, n)
+inline static tinymt32xN_vf tinymt32xN_cvt(tinymt32xN_v a) {
+    return _mm512_cvtepi32_ps(a);
+}
+inline static tinymt32xN_vf tinymt32xN_cast(tinymt32xN_v a) {
+    return _mm512_castsi512_ps(a);
+}
+inline static tinymt32xN_vf tinymt32xN_mulf(tinymt32xN_vf a, float b) {
+    return _mm512_mul_ps(a, _mm512_set1_ps(b));
+}
+inline static tinymt32xN_vf tinymt32xN_rsubf(float a, tinymt32xN_vf b) {
+    return _mm512_sub_ps(_mm512_set1_ps(a), b);
+}
+inline static tinymt32xN_vf tinymt32xN_subf(tinymt32xN_vf a, float b) {
+    return _mm512_sub_ps(a, _mm512_set1_ps(b));
+}
+#elif defined(TINYMT32XN_AVX2)
+typedef __m256i tinymt32xN_v;
+typedef __m256 tinymt32xN_vf;
+inline static tinymt32xN_v tinymt32xN_load(const uint32_t * p) {
+    return _mm256_loadu_si256((const __m256i *)p);
+}
+inline static void tinymt32xN_store(uint32_t * p, tinymt32xN_v a) {
+    _mm256_storeu_si256((__m256i *)p, a);
+}
+inline static void tinymt32xN_storef(float * p, tinymt32xN_vf a) {
+    _mm256_storeu_ps(p, a);
+}
+inline static tinymt32xN_v tinymt32xN_set1(uint32_t a) {
+    return _mm256_set1_epi32((int)a);
+}
+inline static tinymt32xN_v tinymt32xN_and(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm256_and_si256(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_or(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm256_or_si256(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_xor(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm256_xor_si256(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_add(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm256_add_epi32(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_sub(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm256_sub_epi32(a, b);
+}
+#define tinymt32xN_sll(a, n) _mm256_slli_epi32(a, n)
+#define tinymt32xN_srl(a, n) _mm256_srli_epi32(a, n)
+inline static tinymt32xN_vf tinymt32xN_cvt(tinymt32xN_v a) {
+    return _mm256_cvtepi32_ps(a);
+}
+inline static tinymt32xN_vf tinymt32xN_cast(tinymt32xN_v a) {
+    return _mm256_castsi256_ps(a);
+}
+inline static tinymt32xN_vf tinymt32xN_mulf(tinymt32xN_vf a, float b) {
+    return _mm256_mul_ps(a, _mm256_set1_ps(b));
+}
+inline static tinymt32xN_vf tinymt32xN_rsubf(float a, tinymt32xN_vf b) {
+    return _mm256_sub_ps(_mm256_set1_ps(a), b);
+}
+inline static tinymt32xN_vf tinymt32xN_subf(tinymt32xN_vf a, float b) {
+    return _mm256_sub_ps(a, _mm256_set1_ps(b));
+}
+#elif defined(TINYMT32XN_SSE2)
+typedef __m128i tinymt32xN_v;
+typedef __m128 tinymt32xN_vf;
+inline static tinymt32xN_v tinymt32xN_load(const uint32_t * p) {
+    return _mm_loadu_si128((const __m128i *)p);
+}
+inline static void tinymt32xN_store(uint32_t * p, tinymt32xN_v a) {
+    _mm_storeu_si128((__m128i *)p, a);
+}
+inline static void tinymt32xN_storef(float * p, tinymt32xN_vf a) {
+    _mm_storeu_ps(p, a);
+}
+inline static tinymt32xN_v tinymt32xN_set1(uint32_t a) {
+    return _mm_set1_epi32((int)a);
+}
+inline static tinymt32xN_v tinymt32xN_and(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm_and_si128(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_or(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm_or_si128(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_xor(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm_xor_si128(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_add(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm_add_epi32(a, b);
+}
+inline static tinymt32xN_v tinymt32xN_sub(tinymt32xN_v a, tinymt32xN_v b) {
+    return _mm_sub_epi32(a, b);
+}
+#define tinymt32xN_sll(a, n) _mm_slli_epi32(a, n)
+#define tinymt32xN_srl(a, n) _mm_srli_epi32(a, n)
+inline static tinymt32xN_vf tinymt32xN_cvt(tinymt32xN_v a) {
+    return _mm_cvtepi32_ps(a);
+}
+inline static tinymt32xN_vf tinymt32xN_cast(tinymt32xN_v a) {
+    return _mm_castsi128_ps(a);
+}
+inline static tinymt32xN_vf tinymt32xN_mulf(tinymt32xN_vf a, float b) {
+    return _mm_mul_ps(a, _mm_set1_ps(b));
+}
+inline static tinymt32xN_vf tinymt32xN_rsubf(float a, tinymt32xN_vf b) {
+    return _mm_sub_ps(_mm_set1_ps(a), b);
+}
+inline static tinymt32xN_vf tinymt32xN_subf(tinymt32xN_vf a, float b) {
+    return _mm_sub_ps(a, _mm_set1_ps(b));
+}
+#else
+typedef struct { uint32_t u[TINYMT32XN_N]; } tinymt32xN_v;
+typedef struct { float f[TINYMT32XN_N]; } tinymt32xN_vf;
+#define TINYMT32XN_LANES(r, expr) \
+    for (int l = 0; l < TINYMT32XN_N; l++) { (r)[l] = (expr); }
+inline static tinymt32xN_v tinymt32xN_load(const uint32_t * p) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, p[l]); return r;
+}
+inline static void tinymt32xN_store(uint32_t * p, tinymt32xN_v a) {
+    TINYMT32XN_LANES(p, a.u[l]);
+}
+inline static void tinymt32xN_storef(float * p, tinymt32xN_vf a) {
+    TINYMT32XN_LANES(p, a.f[l]);
+}
+inline static tinymt32xN_v tinymt32xN_set1(uint32_t a) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, a); return r;
+}
+inline static tinymt32xN_v tinymt32xN_and(tinymt32xN_v a, tinymt32xN_v b) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, a.u[l] & b.u[l]); return r;
+}
+inline static tinymt32xN_v tinymt32xN_or(tinymt32xN_v a, tinymt32xN_v b) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, a.u[l] | b.u[l]); return r;
+}
+inline static tinymt32xN_v tinymt32xN_xor(tinymt32xN_v a, tinymt32xN_v b) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, a.u[l] ^ b.u[l]); return r;
+}
+inline static tinymt32xN_v tinymt32xN_add(tinymt32xN_v a, tinymt32xN_v b) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, a.u[l] + b.u[l]); return r;
+}
+inline static tinymt32xN_v tinymt32xN_sub(tinymt32xN_v a, tinymt32xN_v b) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, a.u[l] - b.u[l]); return r;
+}
+inline static tinymt32xN_v tinymt32xN_sll(tinymt32xN_v a, int n) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, a.u[l] << n); return r;
+}
+inline static tinymt32xN_v tinymt32xN_srl(tinymt32xN_v a, int n) {
+    tinymt32xN_v r; TINYMT32XN_LANES(r.u, a.u[l] >> n); return r;
+}
+inline static tinymt32xN_vf tinymt32xN_cvt(tinymt32xN_v a) {
+    tinymt32xN_vf r; TINYMT32XN_LANES(r.f, (float)(int32_t)a.u[l]); return r;
+}
+inline static tinymt32xN_vf tinymt32xN_cast(tinymt32xN_v a) {
+    union { uint32_t u; float f; } conv;
+    tinymt32xN_vf r;
+    for (int l = 0; l < TINYMT32XN_N; l++) {
+        conv.u = a.u[l];
+        r.f[l] = conv.f;
+    }
+    return r;
+}
+inline static tinymt32xN_vf tinymt32xN_mulf(tinymt32xN_vf a, float b) {
+    tinymt32xN_vf r; TINYMT32XN_LANES(r.f, a.f[l] * b); return r;
+}
+inline static tinymt32xN_vf tinymt32xN_rsubf(float a, tinymt32xN_vf b) {
+    tinymt32xN_vf r; TINYMT32XN_LANES(r.f, a - b.f[l]); return r;
+}
+inline static tinymt32xN_vf tinymt32xN_subf(tinymt32xN_vf a, float b) {
+    tinymt32xN_vf r; TINYMT32XN_LANES(r.f, a.f[l] - b); return r;
+}
+#undef TINYMT32XN_LANES
+#endif
+
+/**
+ * The state of all lanes in registers, for loops that draw many
+ * numbers. Users should not use it directly.
+ */
+struct TINYMT32XN_REGS_T {
+    tinymt32xN_v status[4];
+    tinymt32xN_v mat1;
+    tinymt32xN_v mat2;
+    tinymt32xN_v tmat;
+};
+
+typedef struct TINYMT32XN_REGS_T tinymt32xN_regs_t;
+
+/**
+ * This function loads the state of all lanes into registers.
+ * Users should not call this function directly.
+ * @param random tinymt32xN internal status
+ * @param regs registers
+ */
+inline static void tinymt32xN_load_regs(const tinymt32xN_t * random,
+                                        tinymt32xN_regs_t * regs) {
+    for (int i = 0; i < 4; i++) {
+        regs->status[i] = tinymt32xN_load(random->status[i]);
+    }
+    regs->mat1 = tinymt32xN_load(random->mat1);
+    regs->mat2 = tinymt32xN_load(random->mat2);
+    regs->tmat = tinymt32xN_load(random->tmat);
+}
+
+/**
+ * This function stores the state of all lanes back from registers.
+ * Users should not call this function directly.
+ * @param random tinymt32xN internal status
+ * @param regs registers
+ */
+inline static void tinymt32xN_store_regs(tinymt32xN_t * random,
+                                         const tinymt32xN_regs_t * regs) {
+    for (int i = 0; i < 4; i++) {
+        tinymt32xN_store(random->status[i], regs->status[i]);
+    }
+}
+
+/**
+ * This function changes internal state of all lanes, as
+ * tinymt32_next_state does for one.
+ * Users should not call this function directly.
+ * @param regs registers
+ */
+inline static void tinymt32xN_next_regs(tinymt32xN_regs_t * regs) {
+    tinymt32xN_v x;
+    tinymt32xN_v y;
+    tinymt32xN_v odd;
+
+    y = regs->status[3];
+    x = tinymt32xN_xor(tinymt32xN_xor(
+            tinymt32xN_and(regs->status[0], tinymt32xN_set1(TINYMT32_MASK)),
+            regs->status[1]), regs->status[2]);
+    x = tinymt32xN_xor(x, tinymt32xN_sll(x, TINYMT32_SH0));
+    y = tinymt32xN_xor(y, tinymt32xN_xor(tinymt32xN_srl(y, TINYMT32_SH0), x));
+    regs->status[0] = regs->status[1];
+    regs->status[1] = regs->status[2];
+    regs->status[2] = tinymt32xN_xor(x, tinymt32xN_sll(y, TINYMT32_SH1));
+    regs->status[3] = y;
+    odd = tinymt32xN_sub(tinymt32xN_set1(0),
+                         tinymt32xN_and(y, tinymt32xN_set1(1)));
+    regs->status[1] = tinymt32xN_xor(regs->status[1],
+                                     tinymt32xN_and(odd, regs->mat1));
+    regs->status[2] = tinymt32xN_xor(regs->status[2],
+                                     tinymt32xN_and(odd, regs->mat2));
+}
+
+/**
+ * This function outputs 32-bit unsigned integers from the internal
+ * state of all lanes, as tinymt32_temper does for one.
+ * Users should not call this function directly.
+ * @param regs registers
+ * @return N 32-bit unsigned integers
+ */
+inline static tinymt32xN_v tinymt32xN_temper_regs(
+    const tinymt32xN_regs_t * regs) {
+    tinymt32xN_v t0, t1;
+
+    t0 = regs->status[3];
+#if defined(LINEARITY_CHECK)
+    t1 = tinymt32xN_xor(regs->status[0],
+                        tinymt32xN_srl(regs->status[2], TINYMT32_SH8));
+#else
+    t1 = tinymt32xN_add(regs->status[0],
+                        tinymt32xN_srl(regs->status[2], TINYMT32_SH8));
+#endif
+    t0 = tinymt32xN_xor(t0, t1);
+    return tinymt32xN_xor(t0, tinymt32xN_and(
+        tinymt32xN_sub(tinymt32xN_set1(0),
+                       tinymt32xN_and(t1, tinymt32xN_set1(1))),
+        regs->tmat));
+}
+
+/**
+ * This function converts tempered outputs to floating point numbers
+ * r (0.0 <= r < 1.0), as tinymt32_generate_float does.
+ * Users should not call this function directly.
+ * @param t tempered outputs
+ * @return N floating point numbers
+ */
+inline static tinymt32xN_vf tinymt32xN_to_float(tinymt32xN_v t) {
+    return tinymt32xN_mulf(tinymt32xN_cvt(tinymt32xN_srl(t, 8)),
+                           TINYMT32_MUL);
+}
+
+/**
+ * This function outputs one 32-bit unsigned integer per lane.
+ * @param random tinymt32xN internal status
+ * @param r N 32-bit unsigned integers (0 <= r < 2^32)
+ */
+inline static void tinymt32xN_generate_uint32(tinymt32xN_t * random,
+                                              uint32_t r[]) {
+    tinymt32xN_regs_t regs;
+
+    tinymt32xN_load_regs(random, &regs);
+    tinymt32xN_next_regs(&regs);
+    tinymt32xN_store(r, tinymt32xN_temper_regs(&regs));
+    tinymt32xN_store_regs(random, &regs);
+}
+
+/**
+ * This function outputs one floating point number per lane.
+ * @param random tinymt32xN internal status
+ * @param r N floating point numbers (0.0 <= r < 1.0)
+ */
+inline static void tinymt32xN_generate_float(tinymt32xN_t * random,
+                                             float r[]) {
+    tinymt32xN_regs_t regs;
+
+    tinymt32xN_load_regs(random, &regs);
+    tinymt32xN_next_regs(&regs);
+    tinymt32xN_storef(r, tinymt32xN_to_float(tinymt32xN_temper_regs(&regs)));
+    tinymt32xN_store_regs(random, &regs);
+}
+
+/**
+ * This function outputs one floating point number per lane.
+ * This function is implemented using union trick.
+ * @param random tinymt32xN internal status
+ * @param r N floating point numbers (1.0 <= r < 2.0)
+ */
+inline static void tinymt32xN_generate_float12(tinymt32xN_t * random,
+                                               float r[]) {
+    tinymt32xN_regs_t regs;
+
+    tinymt32xN_load_regs(random, &regs);
+    tinymt32xN_next_regs(&regs);
+    tinymt32xN_storef(r, tinymt32xN_cast(tinymt32xN_or(
+        tinymt32xN_srl(tinymt32xN_temper_regs(&regs), 9),
+        tinymt32xN_set1(UINT32_C(0x3f800000)))));
+    tinymt32xN_store_regs(random, &regs);
+}
+
+/**
+ * This function outputs one floating point number per lane. It may
+ * return 1.0 and never returns 0.0. Like tinymt32_generate_floatOC, it
+ * changes the internal state twice per number.
+ * @param random tinymt32xN internal status
+ * @param r N floating point numbers (0.0 < r <= 1.0)
+ */
+inline static void tinymt32xN_generate_floatOC(tinymt32xN_t * random,
+                                               float r[]) {
+    tinymt32xN_regs_t regs;
+
+    tinymt32xN_load_regs(random, &regs);
+    tinymt32xN_next_regs(&regs);
+    tinymt32xN_next_regs(&regs);
+    tinymt32xN_storef(r, tinymt32xN_rsubf(1.0f,
+        tinymt32xN_to_float(tinymt32xN_temper_regs(&regs))));
+    tinymt32xN_store_regs(random, &regs);
+}
+
+/**
+ * This function outputs one floating point number per lane. It
+ * returns neither 0.0 nor 1.0.
+ * @param random tinymt32xN internal status
+ * @param r N floating point numbers (0.0 < r < 1.0)
+ */
+inline static void tinymt32xN_generate_floatOO(tinymt32xN_t * random,
+                                               float r[]) {
+    tinymt32xN_regs_t regs;
+
+    tinymt32xN_load_regs(random, &regs);
+    tinymt32xN_next_regs(&regs);
+    tinymt32xN_storef(r, tinymt32xN_subf(tinymt32xN_cast(tinymt32xN_or(
+        tinymt32xN_srl(tinymt32xN_temper_regs(&regs), 9),
+        tinymt32xN_set1(UINT32_C(0x3f800001)))), 1.0f));
+    tinymt32xN_store_regs(random, &regs);
+}
+
+/**
+ * This function outputs one double precision floating point number
+ * per lane, with 32-bit precision.
+ * @param random tinymt32xN internal status
+ * @param r N floating point numbers (0.0 <= r < 1.0)
+ */
+inline static void tinymt32xN_generate_32double(tinymt32xN_t * random,
+                                                double r[]) {
+    uint32_t u[TINYMT32XN_N];
+
+    tinymt32xN_generate_uint32(random, u);
+    for (int l = 0; l < TINYMT32XN_N; l++) {
+        r[l] = u[l] * (1.0 / 4294967296.0);
+    }
+}
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
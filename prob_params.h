@@ -22,6 +22,53 @@
 #define DIMX_NU NCHANNEL
 #define DIMY_NU NX
 
-#define ALMOST_ZERO (1e-19)
+// random number generator of the kernel (see ssa_rng.clh)
+#define SSA_RNG_TINYMT 0    // TinyMT32, jumped per work item at kernel start
+#define SSA_RNG_PHILOX 1    // Philox4x32-10, counter-based, keyed by (seed, trajectory)
+#define SSA_RNG_TINYMT_WP 2 // TinyMT32 with a parameter set of its own per trajectory (tinymt32wp_params.c), no jumps
+#define SSA_RNG SSA_RNG_PHILOX
+#define SSA_TINYMT_PRECOMPUTED 1    // TinyMT only: start states jumped on the host and cached (tinymt32j_states.c)
+
+// the host writes the generator state buffer before the first launch (ssa_rng_start)
+#define SSA_RNG_HOST_STATES ((SSA_RNG == SSA_RNG_TINYMT && SSA_TINYMT_PRECOMPUTED) \
+                             || SSA_RNG == SSA_RNG_TINYMT_WP)
+
+// log used for the exponential waiting time in the kernel (see ssa_rng.clh);
+// native and half are faster on some devices but change the waiting times,
+// so results differ from full-precision runs and between devices
+#define SSA_LOG_FULL   0    // log(), full precision
+#define SSA_LOG_NATIVE 1    // native_log(), implementation-defined precision
+#define SSA_LOG_HALF   2    // half_log(), at least 10 bits of precision
+#define SSA_LOG_MODE SSA_LOG_FULL
+
+// trajectories a work item of ssa_kernel steps in turn (1..SSA_MAX_ITEMS_PER_WI);
+// ssa_opencl --items-per-wi K builds the kernel with -DSSA_ITEMS_PER_WI=K
+#ifndef SSA_ITEMS_PER_WI
+#define SSA_ITEMS_PER_WI 1
+#endif
+#define SSA_MAX_ITEMS_PER_WI 8
+
+// one trajectory per sub-group (ssa_sg_kernel, needs cl_khr_subgroups) for
+// networks of at least SSA_SG_MIN_CHANNELS channels; the host launches
+// SSA_SG_WIDTH work items per trajectory, the expected sub-group size
+#ifndef SSA_SG_KERNEL
+#define SSA_SG_KERNEL 0
+#endif
+#define SSA_SG_MIN_CHANNELS 64
+#define SSA_SG_WIDTH 32
+
+// device progress counters (ssa_opencl --progress builds the kernel with
+// -DSSA_PROGRESS=1): a work item adds its steps and finished trajectories
+// to a global buffer of SSA_PROGRESS_WORDS words every
+// SSA_PROGRESS_INTERVAL steps and when it returns
+#ifndef SSA_PROGRESS
+#define SSA_PROGRESS 0
+#endif
+#define SSA_PROGRESS_INTERVAL 4096
+#define SSA_PROGRESS_FINISHED 0     // trajectories finished on the device
+#define SSA_PROGRESS_STEPS_LO 1     // steps taken, low and high word
+#define SSA_PROGRESS_STEPS_HI 2
+#define SSA_PROGRESS_TIME 3         // largest simulated time of the launch (float bits)
+#define SSA_PROGRESS_WORDS 4
 
 #endif 
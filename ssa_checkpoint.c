@@ -0,0 +1,238 @@
+/**
+ *  FILE:    ssa_checkpoint.c
+ *
+ *  SUMMARY: Versioned binary checkpoints of long ensembles.
+ *
+ *  NOTES:
+ *      Layout (native byte order): header, nsets * nobs statistics
+ *      (n, mean, m2), then the count items of the launch in flight as
+ *      columns x, ftime, counters, done, rng and samples. The header records the
+ *      RNG and the model dimensions so a checkpoint is never resumed by
+ *      a build that would continue it differently.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ssa_checkpoint.h"
+
+#define CHECKPOINT_MAGIC "SSACKPT"
+#define CHECKPOINT_VERSION 1
+
+struct checkpoint_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t rng;           // SSA_RNG
+    uint32_t rng_words;     // SSA_RNG_STATE_WORDS
+    uint32_t nx;
+    uint32_t nchannel;
+    uint32_t nobs;
+    double finaltime;
+    uint64_t seed, nsets, nrep, first, ntraj, batch, rates_hash;
+    uint64_t traj_done;
+    double kernel_time;
+    uint32_t count;
+    uint32_t nsamples;
+};
+
+struct checkpoint_stats {
+    uint64_t n;
+    double mean, m2;
+};
+
+uint64_t ssa_hash64(const void *data, size_t size, uint64_t h)
+{
+    const unsigned char *p = (const unsigned char *) data;
+
+    if (h == 0) h = UINT64_C(14695981039346656037);
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= UINT64_C(1099511628211);
+    }
+    return h;
+}
+
+uint64_t ssa_model_hash(const char *filename, const int *x0)
+{
+    const uint32_t dims[2] = {NX, NCHANNEL};
+    const double finaltime = FINALTIME;
+    uint64_t h = ssa_hash64(dims, sizeof(dims), 0);
+    char buffer[4096];
+    size_t n;
+    FILE *fp = fopen(filename, "rb");
+
+    if (fp == NULL)
+        return 0;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        h = ssa_hash64(buffer, n, h);
+    fclose(fp);
+    h = ssa_hash64(x0, sizeof(int) * NX, h);
+    return ssa_hash64(&finaltime, sizeof(finaltime), h);
+}
+
+static int write_body(FILE *fp, void *arg)
+{
+    const struct ssa_checkpoint *ck = (const struct ssa_checkpoint *) arg;
+    struct checkpoint_header hdr;
+    size_t nstats = ck->nsets * ck->nobs;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    hdr.version = CHECKPOINT_VERSION;
+    hdr.rng = SSA_RNG;
+    hdr.rng_words = SSA_RNG_STATE_WORDS;
+    hdr.nx = NX;
+    hdr.nchannel = NCHANNEL;
+    hdr.nobs = ck->nobs;
+    hdr.finaltime = FINALTIME;
+    hdr.seed = ck->seed;
+    hdr.nsets = ck->nsets;
+    hdr.nrep = ck->nrep;
+    hdr.first = ck->first;
+    hdr.ntraj = ck->ntraj;
+    hdr.batch = ck->batch;
+    hdr.rates_hash = ck->rates_hash;
+    hdr.traj_done = ck->traj_done;
+    hdr.kernel_time = ck->kernel_time;
+    hdr.count = ck->count;
+    hdr.nsamples = ck->nsamples;
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+        return -1;
+
+    for (size_t i = 0; i < nstats; i++) {
+        struct checkpoint_stats st;
+        st.n = ck->stats[i].n;
+        st.mean = ck->stats[i].mean;
+        st.m2 = ck->stats[i].m2;
+        if (fwrite(&st, sizeof(st), 1, fp) != 1)
+            return -1;
+    }
+
+    if (ck->count == 0)
+        return 0;
+    return (fwrite(ck->x, sizeof(int32_t) * NX, ck->count, fp) == ck->count
+            && fwrite(ck->ftime, sizeof(float), ck->count, fp) == ck->count
+            && fwrite(ck->counters, sizeof(int32_t), ck->count, fp) == ck->count
+            && fwrite(ck->done, sizeof(int32_t), ck->count, fp) == ck->count
+            && fwrite(ck->rng, sizeof(uint32_t) * SSA_RNG_STATE_WORDS, ck->count, fp) == ck->count
+            && (ck->nsamples == 0
+                || fwrite(ck->samples, sizeof(int32_t) * NX * ck->nsamples, ck->count, fp) == ck->count))
+        ? 0 : -1;
+}
+
+int ssa_write_atomic(const char *path, int (*write)(FILE *fp, void *arg), void *arg)
+{
+    char tmp[4096 + 32];
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long) getpid());
+    FILE *fp = fopen(tmp, "wb");
+    if (fp == NULL)
+        return -1;
+
+    int ok = write(fp, arg) == 0
+        && fflush(fp) == 0
+        && fsync(fileno(fp)) == 0;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int ssa_checkpoint_write(const char *path, const struct ssa_checkpoint *ck)
+{
+    return ssa_write_atomic(path, write_body, (void *) ck);
+}
+
+int ssa_checkpoint_read(const char *path, struct ssa_checkpoint *ck)
+{
+    struct checkpoint_header hdr;
+    FILE *fp = fopen(path, "rb");
+    size_t nstats;
+
+    memset(ck, 0, sizeof(*ck));
+    if (fp == NULL)
+        return 1;
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1
+        || memcmp(hdr.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0
+        || hdr.version != CHECKPOINT_VERSION
+        || hdr.rng != SSA_RNG
+        || hdr.rng_words != SSA_RNG_STATE_WORDS
+        || hdr.nx != NX
+        || hdr.nchannel != NCHANNEL
+        || hdr.finaltime != FINALTIME) {
+        fclose(fp);
+        return -1;
+    }
+    ck->seed = hdr.seed;
+    ck->nsets = hdr.nsets;
+    ck->nrep = hdr.nrep;
+    ck->first = hdr.first;
+    ck->ntraj = hdr.ntraj;
+    ck->batch = hdr.batch;
+    ck->rates_hash = hdr.rates_hash;
+    ck->nobs = hdr.nobs;
+    ck->traj_done = hdr.traj_done;
+    ck->kernel_time = hdr.kernel_time;
+    ck->count = hdr.count;
+    ck->nsamples = hdr.nsamples;
+
+    nstats = ck->nsets * ck->nobs;
+    ck->stats = (ssa_stats_t *) malloc(sizeof(ssa_stats_t) * (nstats + 1));
+    for (size_t i = 0; i < nstats; i++) {
+        struct checkpoint_stats st;
+        if (fread(&st, sizeof(st), 1, fp) != 1) {
+            fclose(fp);
+            ssa_checkpoint_free(ck);
+            return -1;
+        }
+        ck->stats[i].n = st.n;
+        ck->stats[i].mean = st.mean;
+        ck->stats[i].m2 = st.m2;
+    }
+
+    if (ck->count > 0) {
+        ck->x = (int32_t *) malloc(sizeof(int32_t) * NX * ck->count);
+        ck->ftime = (float *) malloc(sizeof(float) * ck->count);
+        ck->counters = (int32_t *) malloc(sizeof(int32_t) * ck->count);
+        ck->done = (int32_t *) malloc(sizeof(int32_t) * ck->count);
+        ck->rng = (uint32_t *) malloc(sizeof(uint32_t) * SSA_RNG_STATE_WORDS * ck->count);
+        if (ck->nsamples > 0)
+            ck->samples = (int32_t *) malloc(sizeof(int32_t) * NX * ck->nsamples * ck->count);
+        if (fread(ck->x, sizeof(int32_t) * NX, ck->count, fp) != ck->count
+            || fread(ck->ftime, sizeof(float), ck->count, fp) != ck->count
+            || fread(ck->counters, sizeof(int32_t), ck->count, fp) != ck->count
+            || fread(ck->done, sizeof(int32_t), ck->count, fp) != ck->count
+            || fread(ck->rng, sizeof(uint32_t) * SSA_RNG_STATE_WORDS, ck->count, fp) != ck->count
+            || (ck->nsamples > 0
+                && fread(ck->samples, sizeof(int32_t) * NX * ck->nsamples, ck->count, fp) != ck->count)) {
+            fclose(fp);
+            ssa_checkpoint_free(ck);
+            return -1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+void ssa_checkpoint_free(struct ssa_checkpoint *ck)
+{
+    free(ck->stats);
+    free(ck->x);
+    free(ck->ftime);
+    free(ck->counters);
+    free(ck->done);
+    free(ck->rng);
+    free(ck->samples);
+    ck->stats = NULL;
+    ck->x = NULL;
+    ck->ftime = NULL;
+    ck->counters = NULL;
+    ck->done = NULL;
+    ck->rng = NULL;
+    ck->samples = NULL;
+}
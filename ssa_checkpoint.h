@@ -0,0 +1,102 @@
+#ifndef SSA_CHECKPOINT_H
+#define SSA_CHECKPOINT_H
+/**
+ *  FILE:    ssa_checkpoint.h
+ *
+ *  SUMMARY: Crash-safe checkpoints of long ensembles: the statistics of
+ *           the finished launches plus the full device state of the
+ *           launch in flight, written atomically to a versioned binary
+ *           file so a run can be resumed bit-identically.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "prob_params.h"
+#include "ssa_stats.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* words of ssa_rng_t (ssa_rng.clh) */
+#if SSA_RNG == SSA_RNG_PHILOX
+#define SSA_RNG_STATE_WORDS 11      // philox4x32_t: ctr[4], key[2], out[4], idx
+#elif SSA_RNG == SSA_RNG_TINYMT_WP
+#define SSA_RNG_STATE_WORDS 7       // tinymt32wp_t: s0..s3, mat1, mat2, tmat
+#else
+#define SSA_RNG_STATE_WORDS 4       // tinymt32j_t: s0..s3
+#endif
+
+struct ssa_checkpoint {
+    /* identity of the run, must match on resume */
+    uint64_t seed;
+    uint64_t nsets;         // parameter sets
+    uint64_t nrep;          // trajectories per set
+    uint64_t first;         // first trajectory of the run
+    uint64_t ntraj;         // trajectories of the run
+    uint64_t batch;         // trajectories per launch
+    uint64_t rates_hash;    // ssa_hash64 of the rate table
+    uint32_t nobs;          // observables per set
+    uint32_t nsamples;      // time series samples per trajectory
+
+    /* progress */
+    uint64_t traj_done;     // trajectories of the finished launches
+    double kernel_time;     // accumulated kernel time [ns]
+    ssa_stats_t *stats;     // nsets * nobs
+
+    /* launch in flight, starting at trajectory first + traj_done */
+    uint32_t count;         // its trajectories, 0: none
+    int32_t *x;             // count * NX
+    float *ftime;           // count
+    int32_t *counters;      // count
+    int32_t *done;          // count
+    uint32_t *rng;          // count * SSA_RNG_STATE_WORDS
+    int32_t *samples;       // NX * count * nsamples, as ssa_kernel writes them
+};
+
+/**
+ * FNV-1a hash of size bytes, continuing from h (0: start a new hash).
+ */
+uint64_t ssa_hash64(const void *data, size_t size, uint64_t h);
+
+/**
+ * Identity of the model in stores: hash of the model source file (the
+ * kernel), the initial state x0[NX], NX, NCHANNEL and FINALTIME.
+ * Returns 0 if the file cannot be read.
+ */
+uint64_t ssa_model_hash(const char *filename, const int *x0);
+
+/**
+ * Writes path atomically: write(fp, arg) fills a temporary file next to
+ * it, which is flushed to disk and renamed over path, so a crash leaves
+ * the old file or the new one, never a torn one. write returns 0 on
+ * success. Returns 0 on success, -1 on failure with path unchanged.
+ */
+int ssa_write_atomic(const char *path, int (*write)(FILE *fp, void *arg), void *arg);
+
+/**
+ * Writes ck to path through a temporary file that is flushed to disk
+ * and renamed over path, so path always holds a complete checkpoint.
+ * Returns 0 on success, -1 on failure.
+ */
+int ssa_checkpoint_write(const char *path, const struct ssa_checkpoint *ck);
+
+/**
+ * Reads the checkpoint at path into ck, allocating its arrays. Returns
+ * 0 on success, 1 if path does not exist and -1 if it is not a valid
+ * checkpoint of this build (version, RNG, model dimensions).
+ */
+int ssa_checkpoint_read(const char *path, struct ssa_checkpoint *ck);
+
+/**
+ * Frees the arrays allocated by ssa_checkpoint_read.
+ */
+void ssa_checkpoint_free(struct ssa_checkpoint *ck);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
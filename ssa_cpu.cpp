@@ -0,0 +1,860 @@
+/**
+ *  FILE:    ssa_cpu.cpp
+ *
+ *  SUMMARY: Native multithreaded SSA engine for CPU-only nodes: the
+ *           model of ssa_kernel.cl run by a thread pool that steals
+ *           blocks of trajectories, without OpenCL.
+ *
+ *  NOTES:
+ *      Trajectory t draws the TinyMT32 stream the device draws with
+ *      SSA_RNG_TINYMT: init_by_array(seed), then t * 3^40 steps. A
+ *      worker jumps its tinymt32_t to the first trajectory of a block
+ *      (tinymt32j_stream_start) and walks the block with the 3^40 jump
+ *      polynomial, so results do not depend on the number of threads or
+ *      on who ran a block. The uniforms and exponential waiting times
+ *      are the kernel's own ssa_uniform_oc and ssa_exponential, compiled
+ *      for the host through ssa_rng_host.h (with logf for every
+ *      SSA_LOG_MODE). Per trajectory lines, set summaries and stores
+ *      have the format of ssa_opencl.
+ *
+ *      --simd runs L::W trajectories per worker at once, one per vector
+ *      lane (simulate_lanes, ssa_simd.h); with it the final times differ
+ *      from the scalar engine in the last bits. The reactions/s of a
+ *      --simd run are followed by those of the scalar engine on the
+ *      first CPU_REF_BLOCKS blocks per thread, and the speedup.
+ *
+ *      >> ./ssa_cpu --seed 42 --trajectories 131072 --threads 64
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <math.h>
+#include <getopt.h>
+
+#include "prob_params.h"
+#include "ssa_rng_host.h"
+#include "tinymt32j_states.h"
+#include "ssa_sweep.h"
+#include "ssa_stats.h"
+#include "ssa_checkpoint.h"
+#include "ssa_store.h"
+#include "ssa_pack.h"
+#include "ssa_simd.h"
+
+#define PROGRAM_FILE "ssa_kernel.cl"    // the model, hashed into stores
+#define CPU_BLOCK 32                    // trajectories per stolen block
+#define CPU_REF_BLOCKS 8                // --simd: scalar reference blocks per thread
+#define MAX_GRID_AXES NCHANNEL
+
+// the model of ssa_kernel.cl and ssa_opencl.c
+static const int x0[NX] = {1200, 600, 0};
+static const float proprates[NCHANNEL] = {1.0f, 2.0f, 0.00005f};
+static const int nu[NX][NCHANNEL] = {{-1, 1, 0}, {1, -1, -1}, {0, 0, 1}};
+
+/* command line options, a subset of ssa_opencl's */
+struct cpu_options {
+    uint64_t seed;
+    size_t nrep;            // trajectories per parameter set
+    uint64_t first;         // first trajectory of this run
+    size_t ntraj;           // trajectories of this run (0: to the end)
+    size_t batch;           // trajectories per batch (memory bound)
+    int print;
+    const char *sweep_file;
+    char *grid[MAX_GRID_AXES];
+    int ngrid;
+    int nthreads;           // 0: one per hardware thread
+    const char *store;
+    uint32_t nsamples;
+    int pack;
+    int lanes;              // --simd: trajectories per vector, 0: scalar engine
+};
+
+enum {
+    OPT_STORE = 256,
+    OPT_SAMPLES,
+    OPT_PACK,
+    OPT_SIMD
+};
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [options]\n", prog);
+    printf("  -s, --seed N          64-bit run seed (default: time)\n");
+    printf("  -n, --trajectories N  trajectories per parameter set (default: %d)\n", NTHREADS);
+    printf("  -f, --first N         index of the first trajectory to run (default: 0)\n");
+    printf("  -c, --count N         number of trajectories to run (default: all)\n");
+    printf("  -b, --batch N         trajectories held in memory at once (default: all)\n");
+    printf("  -j, --threads N       worker threads (default: one per hardware thread)\n");
+    printf("  -w, --sweep FILE      parameter sets to run, %d rate constants per line\n", NCHANNEL);
+    printf("  -g, --grid CH=LO:HI:N[:log]\n");
+    printf("                        sweep channel CH over N values (repeatable)\n");
+    printf("      --store FILE      write every trajectory to the columnar file FILE\n");
+    printf("      --samples K       also store the state at K evenly spaced times\n");
+    printf("      --pack            delta, zigzag and bit-pack the time series\n");
+    printf("      --simd[=avx2|avx512]\n");
+    printf("                        run a trajectory per vector lane (default: widest built)\n");
+    printf("  -p, --print           print the final state of every trajectory\n");
+    printf("Trajectory t runs replicate t %% N of parameter set t / N with the TinyMT\n");
+    printf("stream of ssa_opencl built with SSA_RNG_TINYMT.\n");
+}
+
+static void parse_options(int argc, char **argv, cpu_options *opt)
+{
+    static const struct option longopts[] = {
+        {"seed",         required_argument, NULL, 's'},
+        {"trajectories", required_argument, NULL, 'n'},
+        {"first",        required_argument, NULL, 'f'},
+        {"count",        required_argument, NULL, 'c'},
+        {"batch",        required_argument, NULL, 'b'},
+        {"threads",      required_argument, NULL, 'j'},
+        {"sweep",        required_argument, NULL, 'w'},
+        {"grid",         required_argument, NULL, 'g'},
+        {"store",        required_argument, NULL, OPT_STORE},
+        {"samples",      required_argument, NULL, OPT_SAMPLES},
+        {"pack",         no_argument,       NULL, OPT_PACK},
+        {"simd",         optional_argument, NULL, OPT_SIMD},
+        {"print",        no_argument,       NULL, 'p'},
+        {"help",         no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int c;
+
+    memset(opt, 0, sizeof(*opt));
+    opt->seed = (uint64_t) time(NULL);
+    opt->nrep = NTHREADS;
+
+    while ((c = getopt_long(argc, argv, "s:n:f:c:b:j:w:g:ph", longopts, NULL)) != -1) {
+        switch (c) {
+        case 's': opt->seed = strtoull(optarg, NULL, 0); break;
+        case 'n': opt->nrep = strtoull(optarg, NULL, 0); break;
+        case 'f': opt->first = strtoull(optarg, NULL, 0); break;
+        case 'c': opt->ntraj = strtoull(optarg, NULL, 0); break;
+        case 'b': opt->batch = strtoull(optarg, NULL, 0); break;
+        case 'j': opt->nthreads = atoi(optarg); break;
+        case 'w': opt->sweep_file = optarg; break;
+        case 'g':
+            if (opt->ngrid == MAX_GRID_AXES) {
+                printf("Error: At most %d grid axes!\n", MAX_GRID_AXES);
+                exit(1);
+            }
+            opt->grid[opt->ngrid++] = optarg;
+            break;
+        case OPT_STORE: opt->store = optarg; break;
+        case OPT_SAMPLES: opt->nsamples = (uint32_t) strtoul(optarg, NULL, 0); break;
+        case OPT_PACK: opt->pack = 1; break;
+        case OPT_SIMD:
+            if (!optarg) opt->lanes = SSA_SIMD_LANES;
+            else if (strcmp(optarg, "avx2") == 0) opt->lanes = 8;
+            else if (strcmp(optarg, "avx512") == 0) opt->lanes = 16;
+            else {
+                printf("Error: Unknown --simd instruction set %s!\n", optarg);
+                exit(1);
+            }
+            if (opt->lanes == 0 || opt->lanes > SSA_SIMD_LANES) {
+                printf("Error: ssa_cpu was built without %s, rebuild with -march=native!\n",
+                       (opt->lanes == 16) ? "AVX-512F" : "AVX2");
+                exit(1);
+            }
+            break;
+        case 'p': opt->print = 1; break;
+        case 'h': usage(argv[0]); exit(0);
+        default:  usage(argv[0]); exit(1);
+        }
+    }
+    if (opt->nrep == 0 || opt->nrep > UINT32_MAX) {
+        printf("Error: Bad number of trajectories per parameter set!\n");
+        exit(1);
+    }
+    if (opt->sweep_file && opt->ngrid > 0) {
+        printf("Error: --sweep and --grid are exclusive!\n");
+        exit(1);
+    }
+    if (opt->nsamples > 0 && !opt->store) {
+        printf("Error: --samples needs --store FILE!\n");
+        exit(1);
+    }
+    if (opt->pack && opt->nsamples == 0) {
+        printf("Error: --pack needs --samples K!\n");
+        exit(1);
+    }
+    if (opt->nthreads <= 0) opt->nthreads = (int) std::thread::hardware_concurrency();
+    if (opt->nthreads <= 0) opt->nthreads = 1;
+}
+
+/*
+ * Fixed set of workers that run the blocks of a batch. Every worker
+ * starts on an even share of the blocks and, once its own are done,
+ * steals the upper half of the remaining blocks of another worker.
+ */
+class thread_pool {
+public:
+    explicit thread_pool(int nthreads)
+        : queues_(new block_queue[nthreads]), nthreads_(nthreads)
+    {
+        for (int i = 0; i < nthreads; i++)
+            threads_.emplace_back(&thread_pool::worker, this, i);
+    }
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto &t : threads_) t.join();
+    }
+
+    typedef std::function<bool(size_t *)> next_fn;
+
+    /* runs job(block) for blocks 0..nblocks-1 and returns when all are done */
+    void run(size_t nblocks, const std::function<void(size_t)> &job)
+    {
+        run_workers(nblocks, [&job](const next_fn &next) {
+            size_t block;
+            while (next(&block)) job(block);
+        });
+    }
+
+    /*
+     * Runs job(next) once on every worker, where next(&block) hands out
+     * the worker's next block, its own or a stolen one, until none are
+     * left; for jobs that keep state across blocks.
+     */
+    void run_workers(size_t nblocks, const std::function<void(const next_fn &)> &job)
+    {
+        if (nblocks == 0) return;
+        std::unique_lock<std::mutex> lock(m_);
+        for (int i = 0; i < nthreads_; i++) {
+            std::lock_guard<std::mutex> q(queues_[i].m);
+            queues_[i].lo = nblocks * i / nthreads_;
+            queues_[i].hi = nblocks * (i + 1) / nthreads_;
+        }
+        job_ = &job;
+        remaining_ = nthreads_;
+        generation_++;
+        cv_.notify_all();
+        done_cv_.wait(lock, [this] { return remaining_ == 0; });
+        job_ = NULL;
+    }
+
+private:
+    struct block_queue {
+        std::mutex m;
+        size_t lo = 0, hi = 0;  // blocks [lo, hi) still to run
+    };
+
+    bool next_block(int id, size_t *block)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queues_[id].m);
+            if (queues_[id].lo < queues_[id].hi) {
+                *block = queues_[id].lo++;
+                return true;
+            }
+        }
+        for (int k = 1; k < nthreads_; k++) {
+            block_queue &victim = queues_[(id + k) % nthreads_];
+            size_t lo, hi;
+            {
+                std::lock_guard<std::mutex> lock(victim.m);
+                size_t n = victim.hi - victim.lo;
+                if (n == 0) continue;
+                hi = victim.hi;
+                lo = hi - (n + 1) / 2;
+                victim.hi = lo;
+            }
+            std::lock_guard<std::mutex> lock(queues_[id].m);
+            queues_[id].lo = lo + 1;
+            queues_[id].hi = hi;
+            *block = lo;
+            return true;
+        }
+        return false;
+    }
+
+    void worker(int id)
+    {
+        uint64_t seen = 0;
+
+        while (true) {
+            const std::function<void(const next_fn &)> *job;
+            {
+                std::unique_lock<std::mutex> lock(m_);
+                cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+                job = job_;
+            }
+            (*job)([this, id](size_t *block) { return next_block(id, block); });
+            std::lock_guard<std::mutex> lock(m_);
+            if (--remaining_ == 0) done_cv_.notify_all();
+        }
+    }
+
+    std::unique_ptr<block_queue[]> queues_;
+    std::vector<std::thread> threads_;
+    int nthreads_;
+    std::mutex m_;
+    std::condition_variable cv_, done_cv_;
+    const std::function<void(const next_fn &)> *job_ = NULL;
+    int remaining_ = 0;         // workers still running the job
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
+
+/* ssa_sample_time of ssa_kernel.cl */
+static inline float sample_time(uint32_t k, uint32_t nsamples)
+{
+    return (float) FINALTIME * (k + 1) / nsamples;
+}
+
+/*
+ * One trajectory, step for step as ssa_kernel: x holds the initial and
+ * then the final state. With nsamples > 0, sample k of species i goes to
+ * samples[i*stride + k].
+ */
+static void simulate(tinymt32_t *rng, const float *k, int *x, float *ftime, int *steps,
+                     int *samples, size_t stride, uint32_t nsamples)
+{
+    float curTime = 0.0f;
+    int counter = 0;
+    uint32_t sidx = 0;
+    bool done = false;
+
+    while (!done) {
+        float a[NCHANNEL], a0, f, jsum, tau;
+        int rxn;
+
+        counter++;
+        uint32_t r1 = tinymt32_generate_uint32(rng);
+        uint32_t r2 = tinymt32_generate_uint32(rng);
+        float rand1 = ssa_uniform_oc(r1), rexp = ssa_exponential(r2);
+
+        a[0] = x[0]*k[0];
+        a[1] = x[1]*k[1];
+        a[2] = x[1]*k[2];
+        a0 = a[0] + a[1] + a[2];
+        if (a0 <= 0.0f) {
+            // absorbing state, as in ssa_kernel: the state holds to the end
+            for (; sidx < nsamples; sidx++)
+                for (int i = 0; i < NX; i++)
+                    samples[i*stride + sidx] = x[i];
+            break;
+        }
+        f = rand1 * a0;
+
+        jsum = 0.0;
+        for (rxn = 0; jsum < f; rxn++) jsum += a[rxn];
+        rxn--;
+
+        for (int i = 0; i < NX; i++) x[i] += nu[i][rxn];
+
+        tau = rexp / a0;
+        curTime += tau;
+
+        bool reverted = false;
+        for (int i = 0; i < NX; i++) {
+            if (x[i] < 0) {
+                for (int j = 0; j < NX; j++) x[j] -= nu[j][rxn];
+                curTime -= tau;
+                reverted = true;
+                break;
+            }
+        }
+
+        if (!reverted) {
+            for (; sidx < nsamples && sample_time(sidx, nsamples) < curTime; sidx++)
+                for (int i = 0; i < NX; i++)
+                    samples[i*stride + sidx] = x[i] - nu[i][rxn];
+        }
+
+        if (curTime > FINALTIME) done = true;
+    }
+    *ftime = curTime;
+    *steps = counter;
+}
+
+static float *get_rate_table(const cpu_options *opt, size_t *nsets)
+{
+    float *rates;
+
+    if (opt->sweep_file) {
+        rates = ssa_sweep_load(opt->sweep_file, nsets);
+    } else if (opt->ngrid > 0) {
+        rates = ssa_sweep_grid(proprates, (char **) opt->grid, opt->ngrid, nsets);
+    } else {
+        rates = (float *) malloc(sizeof(proprates));
+        memcpy(rates, proprates, sizeof(proprates));
+        *nsets = 1;
+    }
+    if (!rates) exit(1);
+    return rates;
+}
+
+/* results of one batch of trajectories, laid out as ssa_opencl's launches */
+struct cpu_batch {
+    std::vector<int> x, steps, samples, base, column;
+    std::vector<float> ftime;
+    std::vector<uint32_t> bits, offsets, packed;
+    std::vector<uint64_t> traj;
+};
+
+/* codes the time series as ssa_pack_bits_kernel and ssa_pack_kernel do */
+static uint32_t pack_batch(cpu_batch *b, size_t count, uint32_t nsamples)
+{
+    const size_t nrows = NX*count;
+    uint32_t total = 0;
+
+    for (size_t r = 0; r < nrows; r++) {
+        const int32_t *row = &b->samples[r*nsamples];
+        b->bits[r] = ssa_pack_bits(row, nsamples);
+        b->base[r] = row[0];
+        b->offsets[r] = total;
+        total += (uint32_t) ssa_pack_words(nsamples, b->bits[r]);
+    }
+    for (size_t r = 0; r < nrows; r++)
+        ssa_pack_row(&b->samples[r*nsamples], nsamples, b->bits[r], &b->packed[b->offsets[r]]);
+    return total;
+}
+
+/* writes a batch as the next rows of the store, in ssa_opencl's column order */
+static void store_batch(ssa_store_t *st, const cpu_options *opt, cpu_batch *b,
+                        uint64_t row, size_t count, uint32_t packed_words)
+{
+    int col = 0, ok;
+
+    ok = ssa_store_write(st, col++, row, b->traj.data(), count) == 0;
+    for (int j = 0; j < NX; j++) {
+        for (size_t i = 0; i < count; i++) b->column[i] = b->x[i*NX+j];
+        ok = ok && ssa_store_write(st, col++, row, b->column.data(), count) == 0;
+    }
+    ok = ok && ssa_store_write(st, col++, row, b->steps.data(), count) == 0;
+    ok = ok && ssa_store_write(st, col++, row, b->ftime.data(), count) == 0;
+    if (opt->pack) {
+        std::vector<ssa_store_packed> pk(count);
+        uint64_t blob = 0;
+
+        ok = ok && ssa_store_append(st, b->packed.data(), packed_words, &blob) == 0;
+        for (int j = 0; j < NX; j++) {
+            for (size_t i = 0; i < count; i++) {
+                size_t r = (size_t) j*count + i;
+                pk[i].offset = blob + b->offsets[r];
+                pk[i].base = b->base[r];
+                pk[i].bits = b->bits[r];
+            }
+            ok = ok && ssa_store_write(st, col++, row, pk.data(), count) == 0;
+        }
+    } else {
+        for (int j = 0; j < NX && opt->nsamples > 0; j++)
+            ok = ok && ssa_store_write(st, col++, row,
+                    &b->samples[(size_t) j*count*opt->nsamples], count) == 0;
+    }
+    if (!ok) {
+        printf("Error: Failed to write store %s!\n", opt->store);
+        exit(1);
+    }
+}
+
+#if SSA_SIMD_LANES > 0
+/* a batch as the lane engine sees it */
+struct lane_job {
+    const cpu_options *opt;
+    const float *rates;
+    f2_polynomial *step;       // the 3^40 jump between trajectories
+    cpu_batch *b;
+    uint64_t traj0;
+    size_t count;
+    float finaltime;        // largest float <= FINALTIME: t > FINALTIME iff t > finaltime
+};
+
+/*
+ * The lane engine: L::W trajectories at once, one per vector lane. Every
+ * lane draws from its trajectory's TinyMT stream (the SoA state s0..s3,
+ * advanced with integer vector ops, so the draws are exactly those of
+ * simulate), picks the channel by counting the partial propensity sums
+ * below f, and masks the update of a step that goes negative. A lane whose
+ * trajectory is past FINALTIME writes it back and takes the next one of
+ * the worker's block, and the next block from the pool; so does a lane whose
+ * propensities are all zero, with its state held to the end. Idle lanes run
+ * along masked out until the last lane is done. The exponential draws use
+ * simd_log instead of logf, so trajectories match simulate's in law but
+ * not bit for bit.
+ */
+template<class L>
+static void simulate_lanes(const lane_job &job, const thread_pool::next_fn &next)
+{
+    typedef typename L::vi vi;
+    typedef typename L::vf vf;
+    typedef typename L::vm vm;
+    enum { W = L::W };
+    const cpu_options *opt = job.opt;
+    cpu_batch *b = job.b;
+    const uint32_t nsamples = opt->nsamples;
+    const size_t stride = job.count * nsamples;
+
+    // lane state, spilled to these arrays when lanes finish or sample
+    alignas(64) int32_t s[4][W], x[NX][W], dx[NX][W], counter[W], sidx[W];
+    alignas(64) float t[W], k[NCHANNEL][W], snext[W];
+    size_t lane_i[W];
+    uint32_t active = 0;
+
+    tinymt32_t cursor;
+    size_t i_next = 0, i_end = 0;
+    tinymt32j_stream_start(&cursor, opt->seed, 0);
+    const vi mat1 = L::set1((int32_t) cursor.mat1);
+    const vi mat2 = L::set1((int32_t) cursor.mat2);
+    const vi tmat = L::set1((int32_t) cursor.tmat);
+
+    // gives lane l the next trajectory, or leaves it idle
+    auto refill = [&](int l) {
+        if (i_next == i_end) {
+            size_t block;
+            if (!next(&block)) {
+                active &= ~(1u << l);
+                t[l] = 0.0f;
+                return;
+            }
+            i_next = block * CPU_BLOCK;
+            i_end = (i_next + CPU_BLOCK < job.count) ? i_next + CPU_BLOCK : job.count;
+            tinymt32j_stream_start(&cursor, opt->seed, job.traj0 + i_next);
+        } else {
+            tinymt32_jump_by_polynomial(&cursor, job.step);
+        }
+        const size_t i = i_next++;
+        const uint64_t tr = job.traj0 + i;
+
+        b->traj[i] = tr;
+        lane_i[l] = i;
+        for (int j = 0; j < 4; j++) s[j][l] = (int32_t) cursor.status[j];
+        for (int j = 0; j < NX; j++) x[j][l] = x0[j];
+        for (int c = 0; c < NCHANNEL; c++) k[c][l] = job.rates[(tr / opt->nrep) * NCHANNEL + c];
+        t[l] = 0.0f;
+        counter[l] = 0;
+        sidx[l] = 0;
+        snext[l] = nsamples ? sample_time(0, nsamples) : 0.0f;
+        active |= 1u << l;
+    };
+
+    for (int l = 0; l < W; l++) refill(l);
+
+    vi s0 = L::load(s[0]), s1 = L::load(s[1]), s2 = L::load(s[2]), s3 = L::load(s[3]);
+    vi xv[NX], dxv[NX];
+    for (int j = 0; j < NX; j++) xv[j] = L::load(x[j]);
+    vf kv[NCHANNEL];
+    for (int c = 0; c < NCHANNEL; c++) kv[c] = L::loadf(k[c]);
+    vf tv = L::loadf(t), snextv = L::loadf(snext);
+    vi cnt = L::load(counter);
+
+    const vi zero = L::set1(0), one = L::set1(1), mask31 = L::set1(0x7fffffff);
+    const vf scale = L::set1f(SSA_RNG_MUL), ft = L::set1f(job.finaltime);
+    vi r[2];
+
+    while (active) {
+        // two draws per lane: tinymt32_next_state and tinymt32_temper
+        for (int d = 0; d < 2; d++) {
+            vi y = s3;
+            vi v = L::xor_(L::xor_(L::and_(s0, mask31), s1), s2);
+            v = L::xor_(v, L::template shl<1>(v));
+            y = L::xor_(y, L::xor_(L::template shr<1>(y), v));
+            s0 = s1;
+            s1 = s2;
+            s2 = L::xor_(v, L::template shl<10>(y));
+            s3 = y;
+            const vi odd = L::sub(zero, L::and_(y, one));
+            s1 = L::xor_(s1, L::and_(odd, mat1));
+            s2 = L::xor_(s2, L::and_(odd, mat2));
+
+            const vi t1 = L::add(s0, L::template shr<8>(s2));
+            const vi t0 = L::xor_(s3, t1);
+            r[d] = L::xor_(t0, L::and_(L::sub(zero, L::and_(t1, one)), tmat));
+        }
+        const vf rand1 = L::mulf(L::cvt(L::add(L::template shr<8>(r[0]), one)), scale);
+        const vf rexp = L::subf(L::set1f(0.0f),
+                                simd_log<L>(L::mulf(L::cvt(L::add(L::template shr<8>(r[1]), one)), scale)));
+
+        const vf xf0 = L::cvt(xv[0]), xf1 = L::cvt(xv[1]);
+        const vf a_0 = L::mulf(xf0, kv[0]);
+        const vf a_1 = L::mulf(xf1, kv[1]);
+        const vf a_2 = L::mulf(xf1, kv[2]);
+        const vf a01 = L::addf(a_0, a_1);
+        const vf a0 = L::addf(a01, a_2);
+        const vf f = L::mulf(rand1, a0);
+        const vm absorbed = L::lef(a0, L::set1f(0.0f));
+
+        // the channel is the number of partial sums below f
+        const vi rxn = L::add(L::ones(L::ltf(a_0, f)), L::ones(L::ltf(a01, f)));
+
+        vm neg = absorbed;      // an absorbed lane fires nothing
+        for (int j = 0; j < NX; j++) {
+            dxv[j] = L::set1(nu[j][NCHANNEL-1]);
+            for (int c = NCHANNEL - 2; c >= 0; c--)
+                dxv[j] = L::select(L::eq(rxn, L::set1(c)), L::set1(nu[j][c]), dxv[j]);
+            xv[j] = L::add(xv[j], dxv[j]);
+            neg = L::or_m(neg, L::lt(xv[j], zero));
+        }
+
+        const vf tau = L::divf(rexp, a0);
+        const vf tprev = tv;
+        tv = L::addf(tv, tau);
+        for (int j = 0; j < NX; j++)
+            xv[j] = L::select(neg, L::sub(xv[j], dxv[j]), xv[j]);
+        tv = L::selectf(neg, L::subf(tv, tau), tv);
+        tv = L::selectf(absorbed, tprev, tv);     // tau is inf there
+        cnt = L::add(cnt, one);
+
+        const uint32_t negbits = L::bitmask(neg);
+        const uint32_t absbits = L::bitmask(absorbed) & active;
+        uint32_t sample = nsamples ? L::bitmask(L::ltf(snextv, tv)) & ~negbits & active : 0;
+        uint32_t done = (L::bitmask(L::gtf(tv, ft)) & active) | absbits;
+        if (!(sample | done)) continue;
+
+        L::store(s[0], s0); L::store(s[1], s1); L::store(s[2], s2); L::store(s[3], s3);
+        for (int j = 0; j < NX; j++) {
+            L::store(x[j], xv[j]);
+            L::store(dx[j], dxv[j]);
+        }
+        L::storef(t, tv);
+        L::store(counter, cnt);
+
+        for (; sample; sample &= sample - 1) {
+            const int l = __builtin_ctz(sample);
+            const size_t i = lane_i[l];
+            uint32_t si = (uint32_t) sidx[l];
+            for (; si < nsamples && sample_time(si, nsamples) < t[l]; si++)
+                for (int j = 0; j < NX; j++)
+                    b->samples[j*stride + i*nsamples + si] = x[j][l] - dx[j][l];
+            sidx[l] = (int32_t) si;
+            snext[l] = (si < nsamples) ? sample_time(si, nsamples) : INFINITY;
+        }
+        for (; done; done &= done - 1) {
+            const int l = __builtin_ctz(done);
+            const size_t i = lane_i[l];
+            if (absbits & (1u << l)) {
+                // absorbing state, as in simulate: the state holds to the end
+                for (uint32_t si = (uint32_t) sidx[l]; si < nsamples; si++)
+                    for (int j = 0; j < NX; j++)
+                        b->samples[j*stride + i*nsamples + si] = x[j][l];
+            }
+            for (int j = 0; j < NX; j++) b->x[i*NX+j] = x[j][l];
+            b->ftime[i] = t[l];
+            b->steps[i] = counter[l];
+            refill(l);
+        }
+
+        s0 = L::load(s[0]); s1 = L::load(s[1]); s2 = L::load(s[2]); s3 = L::load(s[3]);
+        for (int j = 0; j < NX; j++) xv[j] = L::load(x[j]);
+        for (int c = 0; c < NCHANNEL; c++) kv[c] = L::loadf(k[c]);
+        tv = L::loadf(t);
+        snextv = L::loadf(snext);
+        cnt = L::load(counter);
+    }
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    cpu_options opt;
+    size_t nsets;
+
+    parse_options(argc, argv, &opt);
+    float *rates = get_rate_table(&opt, &nsets);
+    const uint64_t total = (uint64_t) nsets * opt.nrep;
+
+    if (opt.first >= total) {
+        printf("Error: First trajectory %llu is past the end of the sweep (%llu)!\n",
+               (unsigned long long) opt.first, (unsigned long long) total);
+        exit(1);
+    }
+    if (opt.ntraj == 0 || opt.ntraj > total - opt.first) opt.ntraj = total - opt.first;
+    if (opt.batch == 0 || opt.batch > opt.ntraj) opt.batch = opt.ntraj;
+    if (opt.first + opt.ntraj - 1 > TINYMT32J_MAX_TRAJ) {
+        printf("Error: TinyMT streams support trajectory indices up to %llu!\n",
+               (unsigned long long) TINYMT32J_MAX_TRAJ);
+        exit(1);
+    }
+
+    const int nobs = NX + 1;
+    std::vector<ssa_stats_t> stats(nsets * nobs);
+    for (auto &s : stats) ssa_stats_init(&s);
+
+    ssa_store_t store;
+    if (opt.store) {
+        struct ssa_store_header sh;
+
+        ssa_store_init(&sh);
+        sh.model_hash = ssa_model_hash(PROGRAM_FILE, x0);
+        sh.rates_hash = ssa_hash64(rates, sizeof(float) * NCHANNEL * nsets, 0);
+        sh.seed = opt.seed;
+        sh.nsets = nsets;
+        sh.nrep = opt.nrep;
+        sh.first = opt.first;
+        sh.capacity = opt.ntraj;
+        sh.nx = NX;
+        sh.nchannel = NCHANNEL;
+        sh.nsamples = opt.nsamples;
+        sh.rng = SSA_RNG_TINYMT;
+        sh.finaltime = FINALTIME;
+        ssa_store_add_result_columns(&sh, opt.pack);
+        if (sh.model_hash == 0) {
+            printf("Error: Couldn't read the model %s!\n", PROGRAM_FILE);
+            exit(1);
+        }
+        if (ssa_store_create(&store, opt.store, &sh, rates, 0) != 0)
+            exit(1);
+    }
+
+    printf("seed=%llu, %zu parameter set(s) x %zu trajectories, running %llu..%llu\n",
+           (unsigned long long) opt.seed, nsets, opt.nrep,
+           (unsigned long long) opt.first, (unsigned long long) (opt.first + opt.ntraj - 1));
+
+    f2_polynomial step;
+    tinymt32j_stream_step(&step);
+
+    cpu_batch b;
+    b.x.resize(NX * opt.batch);
+    b.steps.resize(opt.batch);
+    b.ftime.resize(opt.batch);
+    b.traj.resize(opt.batch);
+    b.column.resize(opt.batch);
+    if (opt.nsamples > 0) b.samples.resize((size_t) NX * opt.batch * opt.nsamples);
+    if (opt.pack) {
+        b.bits.resize(NX * opt.batch);
+        b.base.resize(NX * opt.batch);
+        b.offsets.resize(NX * opt.batch);
+        b.packed.resize((size_t) NX * opt.batch * opt.nsamples);
+    }
+
+    float finaltime = (float) FINALTIME;
+    if ((double) finaltime > FINALTIME) finaltime = nextafterf(finaltime, 0.0f);
+    uint64_t reactions = 0;
+
+    thread_pool pool(opt.nthreads);
+
+    // the scalar engine, trajectories traj0..traj0+count-1 into b
+    auto run_scalar = [&](uint64_t traj0, size_t count) {
+        pool.run((count + CPU_BLOCK - 1) / CPU_BLOCK, [&](size_t block) {
+            const size_t i0 = block * CPU_BLOCK;
+            const size_t i1 = (i0 + CPU_BLOCK < count) ? i0 + CPU_BLOCK : count;
+            tinymt32_t cursor, rng;
+
+            // the worker's generator, at the start of the block's first trajectory
+            tinymt32j_stream_start(&cursor, opt.seed, traj0 + i0);
+            for (size_t i = i0; i < i1; i++) {
+                const uint64_t t = traj0 + i;
+                rng = cursor;
+                if (i + 1 < i1) tinymt32_jump_by_polynomial(&cursor, &step);
+
+                b.traj[i] = t;
+                for (int j = 0; j < NX; j++) b.x[i*NX+j] = x0[j];
+                simulate(&rng, rates + (t / opt.nrep) * NCHANNEL, &b.x[i*NX],
+                         &b.ftime[i], &b.steps[i],
+                         opt.nsamples ? &b.samples[i * opt.nsamples] : NULL,
+                         count * opt.nsamples, opt.nsamples);
+            }
+        });
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t done = 0; done < opt.ntraj; done += opt.batch) {
+        const size_t count = (opt.ntraj - done < opt.batch) ? opt.ntraj - done : opt.batch;
+        const uint64_t traj0 = opt.first + done;
+
+#if SSA_SIMD_LANES > 0
+        if (opt.lanes > 0) {
+            const size_t nblocks = (count + CPU_BLOCK - 1) / CPU_BLOCK;
+            const lane_job job = {&opt, rates, &step, &b, traj0, count, finaltime};
+
+            pool.run_workers(nblocks, [&job, &opt](const thread_pool::next_fn &next) {
+#if SSA_SIMD_LANES == 16
+                if (opt.lanes == 16) {
+                    simulate_lanes<simd_avx512>(job, next);
+                    return;
+                }
+#endif
+                simulate_lanes<simd_avx2>(job, next);
+            });
+        }
+#endif
+        if (opt.lanes == 0) run_scalar(traj0, count);
+
+        // in trajectory order, as ssa_opencl accumulates a launch
+        for (size_t i = 0; i < count; i++) {
+            const uint64_t t = b.traj[i];
+            ssa_stats_t *st = &stats[(t / opt.nrep) * nobs];
+            const int *xt = &b.x[i*NX];
+
+            for (int j = 0; j < NX; j++) ssa_stats_add(&st[j], xt[j]);
+            ssa_stats_add(&st[NX], b.steps[i]);
+            reactions += (uint32_t) b.steps[i];
+            if (opt.print) {
+                printf("%llu (%llu/%llu): ", (unsigned long long) t,
+                       (unsigned long long) (t / opt.nrep), (unsigned long long) (t % opt.nrep));
+                for (int j = 0; j < NX; j++) printf("%d ", xt[j]);
+                printf(", %d, ", b.steps[i]);
+                printf("%f\n", b.ftime[i]);
+            }
+        }
+        if (opt.store) {
+            uint32_t packed_words = opt.pack ? pack_batch(&b, count, opt.nsamples) : 0;
+            store_batch(&store, &opt, &b, done, count, packed_words);
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Kernel exec time = %.3f msec (%d threads)\n", elapsed * 1000.0, opt.nthreads);
+    if (opt.lanes > 0) {
+        const double rate = reactions / elapsed / opt.nthreads;
+
+        // scalar reference on the first trajectories of the range, batch
+        // buffers reused; its results are discarded
+        const size_t ref_max = (size_t) CPU_REF_BLOCKS * CPU_BLOCK * opt.nthreads;
+        const size_t nref = (opt.batch < ref_max) ? opt.batch : ref_max;
+        uint64_t ref_reactions = 0;
+        auto ref_start = std::chrono::steady_clock::now();
+
+        run_scalar(opt.first, nref);
+        double ref_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - ref_start).count();
+        for (size_t i = 0; i < nref; i++) ref_reactions += (uint32_t) b.steps[i];
+        const double ref_rate = ref_reactions / ref_elapsed / opt.nthreads;
+
+        printf("%.4g reactions/s per thread (%s, %d lanes)\n", rate,
+               (opt.lanes == 16) ? "avx512" : "avx2", opt.lanes);
+        printf("%.4g reactions/s per thread (scalar reference, %zu trajectories), speedup %.2fx\n",
+               ref_rate, nref, rate / ref_rate);
+    } else
+        printf("%.4g reactions/s per thread (scalar)\n", reactions / elapsed / opt.nthreads);
+
+    if (opt.store && ssa_store_close(&store, opt.ntraj) != 0) {
+        printf("Error: Failed to write store %s!\n", opt.store);
+        exit(1);
+    }
+
+    for (size_t set = 0; set < nsets; set++) {
+        const ssa_stats_t *xs = &stats[set * nobs];
+
+        if (xs[0].n == 0) continue;
+        printf("set %zu: rates", set);
+        for (int c = 0; c < NCHANNEL; c++) printf(" %g", rates[set*NCHANNEL+c]);
+        printf(", n=%zu, x mean/sd", xs[0].n);
+        for (int j = 0; j < NX; j++)
+            printf(" %.3f/%.3f", xs[j].mean, ssa_stats_sd(&xs[j]));
+        printf(", steps %.1f\n", xs[NX].mean);
+    }
+
+    free(rates);
+    return 0;
+}
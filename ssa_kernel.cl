@@ -1,6 +1,10 @@
 #include "prob_params.h"
-#include "TinyMT/opencl/tinymt32_jump.clh"
+#include "ssa_rng.clh"
+#include "ssa_pack.clh"
 
+// no fused multiply-adds: the host engines (ssa_tail.c, ssa_cpu.cpp) are
+// built with -ffp-contract=off and do the same sums
+#pragma OPENCL FP_CONTRACT OFF
 
 /// example OpenCL kernel
 //
@@ -21,68 +25,189 @@ __kernel void example( __global int* output, const unsigned int count, unsigned
     }                                                
 }                                                  
 
+/// trajectory run by item i of a launch
+//
+inline static ulong ssa_traj(size_t i, ulong traj_base, uint nrep, uint span)
+{
+    return traj_base + (i / span) * nrep + i % span;
+}
+
+/// time of time series sample k of nsamples, the last one at FINALTIME
+//
+inline static float ssa_sample_time(uint k, uint nsamples)
+{
+    return (float)FINALTIME * (k + 1) / nsamples;
+}
+
+/// adds the steps and finished trajectories of a work item since its
+/// last report to the progress counters and raises the launch's
+/// largest simulated time to t
+//
+// The step count is split into two words, carried on overflow of the
+// low one, so only 32-bit atomics are needed. Non-negative floats order
+// like their bits.
+inline static void ssa_progress_add(volatile __global uint *progress, uint steps, uint finished, float t)
+{
+    if (steps > 0) {
+        const uint old = atomic_add(&progress[SSA_PROGRESS_STEPS_LO], steps);
+        if (old + steps < old) atomic_inc(&progress[SSA_PROGRESS_STEPS_HI]);
+    }
+    if (finished > 0) atomic_add(&progress[SSA_PROGRESS_FINISHED], finished);
+    atomic_max(&progress[SSA_PROGRESS_TIME], as_uint(fmin(t, (float)FINALTIME)));
+}
+
 /// ssa kernel CUDA version
 //
+// Trajectory t is replicate t % nrep of parameter set t / nrep, whose
+// rate constants are row t / nrep of rates (NCHANNEL floats per set).
+// A launch runs span consecutive replicates of consecutive sets from
+// trajectory traj_base on (ssa_traj); with span == nrep, launch item i
+// runs trajectory traj_base+i. Work items past count are idle.
+//
+// A launch takes at most max_steps steps per item (0: no limit), so a
+// long ensemble can be run in slices and checkpointed in between. The
+// state of an item (x, ftime, counters, done, rng_state) is kept in
+// global memory; start == 1 begins the trajectories, start == 0
+// continues them from that state. With SSA_RNG_HOST_STATES the host
+// writes the start states (SSA_TINYMT_PRECOMPUTED) or the per-trajectory
+// TinyMT parameter sets (SSA_RNG_TINYMT_WP) into rng_state before the
+// first slice.
+//
+// With nsamples > 0 the state at ssa_sample_time(k) is recorded for
+// every k, species-major: samples[(j*count + i)*nsamples + k] holds
+// species j of launch item i, so each species of a launch is one
+// contiguous block.
+//
+// Launch slot s runs launch item i = order[s], a permutation of
+// 0..count-1 that the host may sort by expected cost so that the items
+// of a work group take a similar number of steps (--cost-order). Every
+// buffer is indexed by i, so the results come back in launch order
+// whatever the permutation.
+//
+// A work item runs SSA_ITEMS_PER_WI slots (lanes) and steps them in
+// turn, one step of every lane not yet done per loop iteration, so the
+// RNG, log and divide of one lane overlap with those of the others.
+// Lane j of local work item tx in group g runs slot
+// (g*SSA_ITEMS_PER_WI + j)*XBLOCKSIZE + tx: a group covers
+// SSA_ITEMS_PER_WI*XBLOCKSIZE consecutive slots and each lane reads
+// consecutive slots across the group. Every lane takes exactly the
+// steps of its trajectory, so results do not depend on SSA_ITEMS_PER_WI.
+//
+// Built with SSA_PROGRESS, every work item reports to progress (see
+// ssa_progress_add) every SSA_PROGRESS_INTERVAL iterations and at the
+// end of the launch, so the host can watch a launch while it runs.
 __kernel void ssa_kernel(__global int* x, __global float* ftime, 
-                         const unsigned int count, const unsigned int seed, __global int* counters)
+                         const unsigned int count, const ulong seed, const ulong traj_base,
+                         __global int* counters,
+                         __global const float* rates, const unsigned int nrep,
+                         const unsigned int span, __global ssa_rng_t* rng_state,
+                         __global int* done_flags, const unsigned int max_steps,
+                         const int start, __global int* samples,
+                         const unsigned int nsamples, __global const uint* order,
+                         volatile __global uint* progress)
 {
-    size_t tid = get_global_id(0);   
-
-    __local int xShared[NX*XBLOCKSIZE];  // shared mem is per-blcok
+    __local int xShared[NX*XBLOCKSIZE*SSA_ITEMS_PER_WI];  // shared mem is per-blcok
     __local int nu[DIMX_NU][DIMY_NU];
-    __local float proprates[NCHANNEL];
-    __local int done[XBLOCKSIZE]; // XBLOCKSIZE == blockDim.x == local_size == get_local_size(0)
+    __local int done[XBLOCKSIZE]; // all lanes of the work item done; XBLOCKSIZE == get_local_size(0)
 
-    const int xBegin = NX * tid;
     int tx = get_local_id(0);
-    const int xSharedBegin = tx * NX;
+    const size_t slot0 = get_group_id(0) * SSA_ITEMS_PER_WI * XBLOCKSIZE + tx;
+
+    // per lane: a work-group may span parameter sets
+    int active[SSA_ITEMS_PER_WI], ldone[SSA_ITEMS_PER_WI];
+    size_t item[SSA_ITEMS_PER_WI];
+    int xSharedBegin[SSA_ITEMS_PER_WI];
+    float proprates[SSA_ITEMS_PER_WI][NCHANNEL];
+    float curTime[SSA_ITEMS_PER_WI];
+    int counter[SSA_ITEMS_PER_WI];
+    unsigned int sidx[SSA_ITEMS_PER_WI];  // next time series sample
+    ssa_rng_t rng[SSA_ITEMS_PER_WI];
 
     if (tx == 0) {
         nu[0][0] = -1; nu[0][1] = 1;  nu[0][2] = 0;
         nu[1][0] = 1;  nu[1][1] = -1; nu[1][2] = -1;
         nu[2][0] = 0;  nu[2][1] = 0;  nu[2][2] = 1;
-
-        proprates[0] = 1.0f;
-        proprates[1] = 2.0f;
-        proprates[2] = 0.00005f;
     }
 
     barrier(CLK_LOCAL_MEM_FENCE);
 
-    for (int i=0; i<NX; i++) xShared[xSharedBegin+i] = x[xBegin+i];
-    
-    float curTime = 0.0f;
-    
-    float a0, a[3];
-    float f, jsum, tau;
-    int rxn;
-    float rand1, rand2;
-    int total_done;
-    int counter = 0;
+    int all_done = 1;
+    for (int l=0; l<SSA_ITEMS_PER_WI; l++) {
+        const size_t slot = slot0 + l * XBLOCKSIZE;
 
-    done[tx] = 0;
+        active[l] = slot < count;
+        item[l] = active[l] ? order[slot] : slot;
+        xSharedBegin[l] = (l * XBLOCKSIZE + tx) * NX;
+        curTime[l] = 0.0f;
+        counter[l] = 0;
+        sidx[l] = 0;
 
-    tinymt32j_t tinymt;
-    tinymt32j_init_jump(&tinymt, (tid+seed)); //init rng to do something somewhat random within each thread
-    rand1 = tinymt32j_single01(&tinymt);
-    rand2 = tinymt32j_single01(&tinymt);
+        const ulong traj = ssa_traj(item[l], traj_base, nrep, span);
+
+        if (active[l]) {
+            const ulong set = traj / nrep;
+            for (int i=0; i<NX; i++) xShared[xSharedBegin[l]+i] = x[NX*item[l]+i];
+            for (int c=0; c<NCHANNEL; c++) proprates[l][c] = rates[set*NCHANNEL+c];
+        }
 
-    while (rand1 < ALMOST_ZERO || rand2 < ALMOST_ZERO) {
-        rand1 = tinymt32j_single01(&tinymt);
-        rand2 = tinymt32j_single01(&tinymt);
+        if (start) {
+            ldone[l] = !active[l];
+            if (active[l]) ssa_rng_start(&rng[l], rng_state, item[l], seed, traj); // stream depends on (seed, trajectory) only
+        } else {
+            ldone[l] = !active[l] || done_flags[item[l]];
+            if (active[l]) {
+                curTime[l] = ftime[item[l]];
+                counter[l] = counters[item[l]];
+                ssa_rng_status_read(&rng[l], rng_state, item[l]);
+            }
+        }
+        while (sidx[l] < nsamples && ssa_sample_time(sidx[l], nsamples) < curTime[l]) sidx[l]++;
+        all_done &= ldone[l];
     }
+    done[tx] = all_done;
 
-    while (1) {
-        counter++;
+    unsigned int steps = 0;
+#if SSA_PROGRESS
+    uint progress_steps = 0, progress_done = 0;    // not yet reported
+#endif
+
+    while (!done[tx] && (max_steps == 0 || steps < max_steps)) {
+        steps++;
+        all_done = 1;
+
+        for (int l=0; l<SSA_ITEMS_PER_WI; l++) {
+            if (ldone[l]) continue;
+
+            const int xb = xSharedBegin[l];
+            float a0, a[3];
+            float f, jsum, tau;
+            int rxn;
+            float rand1, rexp;
+
+            counter[l]++;
+
+            // rand1 in (0, 1], rexp ~ Exp(1): no rejection loop needed
+            ssa_rng_draw2(&rng[l], &rand1, &rexp);
 
-        if (!done[tx]) {
             // take step -- 1. choose the channel to fire
-            //printf("x0 = %d, x1 = %d, x2 = %d\n", x[xBegin], x[xBegin+1], x[xBegin+2]);
-            a[0] = xShared[xSharedBegin]*proprates[0];
-            a[1] = xShared[xSharedBegin+1]*proprates[1];
-            a[2] = xShared[xSharedBegin+1]*proprates[2];
+            a[0] = xShared[xb]*proprates[l][0];
+            a[1] = xShared[xb+1]*proprates[l][1];
+            a[2] = xShared[xb+1]*proprates[l][2];
 
             a0 = a[0] + a[1] + a[2];
+
+            // absorbing state: nothing fires again and the state holds to the end
+            if (a0 <= 0.0f) {
+                for (; sidx[l] < nsamples; sidx[l]++)
+                    for (int i=0; i<NX; i++)
+                        samples[(i*count + item[l])*nsamples + sidx[l]] = xShared[xb+i];
+                ldone[l] = 1;
+#if SSA_PROGRESS
+                progress_steps++;
+                progress_done++;
+#endif
+                continue;
+            }
             f = rand1 * a0;
 
             jsum = 0.0;
@@ -93,41 +218,342 @@ __kernel void ssa_kernel(__global int* x, __global float* ftime,
 
             // take step -- 2. fire the chosen channel
             for (int i=0; i<NX; i++) {
-                xShared[xSharedBegin+i] += nu[i][rxn];
+                xShared[xb+i] += nu[i][rxn];
             }
 
             // take step -- 3. calculate the time step
-            tau = -log(rand2) / a0;
-            curTime += tau;
+            tau = rexp / a0;
+            curTime[l] += tau;
 
             // negative state check
+            int reverted = 0;
             for (int i=0; i<NX; i++) {
-                if (xShared[xSharedBegin+i] < 0) {
+                if (xShared[xb+i] < 0) {
                     for (int j=0; j<NX; j++) { 
-                        xShared[xSharedBegin+j] -= nu[j][rxn];
+                        xShared[xb+j] -= nu[j][rxn];
                     }
 
-                    curTime -= tau;
+                    curTime[l] -= tau;
+                    reverted = 1;
                     break;
                 }
             }
 
-            if (curTime > FINALTIME) done[tx] = 1;
-
-            rand1 = tinymt32j_single01(&tinymt);
-            rand2 = tinymt32j_single01(&tinymt);
-            while (rand1 < ALMOST_ZERO || rand2 < ALMOST_ZERO) {
-                rand1 = tinymt32j_single01(&tinymt);
-                rand2 = tinymt32j_single01(&tinymt);
+            // time series: the state before this step held until curTime
+            if (!reverted) {
+                for (; sidx[l] < nsamples && ssa_sample_time(sidx[l], nsamples) < curTime[l]; sidx[l]++)
+                    for (int i=0; i<NX; i++)
+                        samples[(i*count + item[l])*nsamples + sidx[l]] = xShared[xb+i] - nu[i][rxn];
             }
+
+            if (curTime[l] > FINALTIME) ldone[l] = 1;
+            all_done &= ldone[l];
+#if SSA_PROGRESS
+            progress_steps++;
+            progress_done += ldone[l];
+#endif
         }
-        if (done[tx]) break;
+        done[tx] = all_done;
+
+#if SSA_PROGRESS
+        if (steps % SSA_PROGRESS_INTERVAL == 0) {
+            float t = 0.0f;
+            for (int l=0; l<SSA_ITEMS_PER_WI; l++) if (active[l]) t = fmax(t, curTime[l]);
+            ssa_progress_add(progress, progress_steps, progress_done, t);
+            progress_steps = progress_done = 0;
+        }
+#endif
+    }
+
+#if SSA_PROGRESS
+    if (progress_steps > 0) {
+        float t = 0.0f;
+        for (int l=0; l<SSA_ITEMS_PER_WI; l++) if (active[l]) t = fmax(t, curTime[l]);
+        ssa_progress_add(progress, progress_steps, progress_done, t);
     }
+#endif
 
     barrier(CLK_LOCAL_MEM_FENCE);
 
+    for (int l=0; l<SSA_ITEMS_PER_WI; l++) {
+        if (!active[l]) continue;
+
+        ftime[item[l]] = curTime[l];
+        counters[item[l]] = counter[l];
+        for (int i=0; i<NX; i++) x[NX*item[l]+i] = xShared[xSharedBegin[l]+i];
+        done_flags[item[l]] = ldone[l];
+        ssa_rng_status_write(rng_state, item[l], &rng[l]);
+    }
+}
+
+#if SSA_SG_KERNEL
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+
+// the model of ssa_kernel as tables: channel c fires at rate
+// k_c * x[ssa_sg_reactant[c]] and changes species s by ssa_sg_nu[s][c]
+__constant int ssa_sg_nu[NX][NCHANNEL] = {{-1, 1, 0}, {1, -1, -1}, {0, 0, 1}};
+__constant int ssa_sg_reactant[NCHANNEL] = {0, 1, 1};
+
+/// ssa kernel, one trajectory per sub-group
+//
+// For networks with many channels (--kernel subgroup, the host's choice
+// from SSA_SG_MIN_CHANNELS channels on). Takes the arguments of
+// ssa_kernel and gives the same results in law; the sums are reduced in
+// the order of the device, so they may round differently.
+//
+// Lane l of a sub-group of width w handles channels l, l+w, ... and
+// species l, l+w, ...: a0 is a sub_group_reduce_add of the lanes'
+// propensities, and the channel to fire is the first whose inclusive
+// prefix sum (sub_group_scan_inclusive_add, w channels at a time)
+// reaches rand1 * a0, found by counting the lanes below it. The state
+// is shared through local memory; every lane draws the same numbers
+// from its copy of the trajectory's stream, and lane 0 writes the
+// per-item results and progress reports. Sub-groups stride over the
+// launch slots, so any global size runs every item.
+__kernel void ssa_sg_kernel(__global int* x, __global float* ftime,
+                            const unsigned int count, const ulong seed, const ulong traj_base,
+                            __global int* counters,
+                            __global const float* rates, const unsigned int nrep,
+                            const unsigned int span, __global ssa_rng_t* rng_state,
+                            __global int* done_flags, const unsigned int max_steps,
+                            const int start, __global int* samples,
+                            const unsigned int nsamples, __global const uint* order,
+                            volatile __global uint* progress)
+{
+    __local int xShared[XBLOCKSIZE][NX];  // one state per sub-group, at most one per work item
+
+    const uint lane = get_sub_group_local_id();
+    const uint width = get_sub_group_size();
+    const size_t nsg = get_num_groups(0) * get_num_sub_groups();
+    const uint sg = get_sub_group_id();
+
+    for (size_t slot = get_group_id(0) * get_num_sub_groups() + get_sub_group_id();
+         slot < count; slot += nsg) {
+        const size_t item = order[slot];
+        const ulong traj = ssa_traj(item, traj_base, nrep, span);
+        __global const float *k = rates + (traj / nrep) * NCHANNEL;
+        float curTime = 0.0f;
+        int counter = 0;
+        int done;
+        unsigned int steps = 0;
+        unsigned int sidx = 0;  // next time series sample
+        ssa_rng_t rng;
+
+        for (uint s=lane; s<NX; s+=width) xShared[sg][s] = x[NX*item+s];
+        if (start) {
+            done = 0;
+            ssa_rng_start(&rng, rng_state, item, seed, traj); // stream depends on (seed, trajectory) only
+        } else {
+            done = done_flags[item];
+            curTime = ftime[item];
+            counter = counters[item];
+            ssa_rng_status_read(&rng, rng_state, item);
+        }
+        while (sidx < nsamples && ssa_sample_time(sidx, nsamples) < curTime) sidx++;
+        sub_group_barrier(CLK_LOCAL_MEM_FENCE);
+
+        while (!done && (max_steps == 0 || steps < max_steps)) {
+            float a0 = 0.0f, f, carry = 0.0f, rand1, rexp;
+            int rxn = -1, last = -1;
+
+            steps++;
+            counter++;
+
+            // rand1 in (0, 1], rexp ~ Exp(1): no rejection loop needed
+            ssa_rng_draw2(&rng, &rand1, &rexp);
+
+            // take step -- 1. total propensity
+            for (uint base=0; base<NCHANNEL; base+=width) {
+                const uint c = base + lane;
+                const float a = (c < NCHANNEL) ? k[c]*xShared[sg][ssa_sg_reactant[c]] : 0.0f;
+                a0 += sub_group_reduce_add(a);
+            }
+            // absorbing state: nothing fires again and the state holds to
+            // the end; a0 is the same on every lane
+            if (a0 <= 0.0f) {
+                for (; sidx < nsamples; sidx++)
+                    for (uint s=lane; s<NX; s+=width)
+                        samples[(s*count + item)*nsamples + sidx] = xShared[sg][s];
+                done = 1;
+            } else {
+                f = rand1 * a0;
+
+                // choose the channel to fire: first prefix sum >= f
+                for (uint base=0; base<NCHANNEL && rxn < 0; base+=width) {
+                    const uint c = base + lane;
+                    const float a = (c < NCHANNEL) ? k[c]*xShared[sg][ssa_sg_reactant[c]] : 0.0f;
+                    const float jsum = carry + sub_group_scan_inclusive_add(a);
+                    const int below = sub_group_reduce_add(jsum < f ? 1 : 0);
+
+                    last = max(last, sub_group_reduce_max(a > 0.0f ? (int)c : -1));
+                    if (below < (int)width) rxn = base + below;
+                    carry = sub_group_broadcast(jsum, width - 1);
+                }
+                if (rxn < 0 || rxn >= NCHANNEL) rxn = last;  // jsum rounded below f
+
+                // take step -- 2. fire the chosen channel
+                int negative = 0;
+                for (uint s=lane; s<NX; s+=width) {
+                    xShared[sg][s] += ssa_sg_nu[s][rxn];
+                    negative |= xShared[sg][s] < 0;
+                }
+
+                // take step -- 3. calculate the time step
+                const float tau = rexp / a0;
+                curTime += tau;
+
+                // negative state check
+                if (sub_group_any(negative)) {
+                    for (uint s=lane; s<NX; s+=width) xShared[sg][s] -= ssa_sg_nu[s][rxn];
+                    curTime -= tau;
+                } else {
+                    // time series: the state before this step held until curTime
+                    for (; sidx < nsamples && ssa_sample_time(sidx, nsamples) < curTime; sidx++)
+                        for (uint s=lane; s<NX; s+=width)
+                            samples[(s*count + item)*nsamples + sidx] = xShared[sg][s] - ssa_sg_nu[s][rxn];
+                }
+            }
+
+            if (curTime > FINALTIME) done = 1;
+#if SSA_PROGRESS
+            if (lane == 0 && steps % SSA_PROGRESS_INTERVAL == 0)
+                ssa_progress_add(progress, SSA_PROGRESS_INTERVAL, done, curTime);
+#endif
+            sub_group_barrier(CLK_LOCAL_MEM_FENCE);
+        }
+
+        for (uint s=lane; s<NX; s+=width) x[NX*item+s] = xShared[sg][s];
+        if (lane == 0) {
+#if SSA_PROGRESS
+            if (steps % SSA_PROGRESS_INTERVAL != 0)
+                ssa_progress_add(progress, steps % SSA_PROGRESS_INTERVAL, done, curTime);
+#endif
+            ftime[item] = curTime;
+            counters[item] = counter;
+            done_flags[item] = done;
+            ssa_rng_status_write(rng_state, item, &rng);
+        }
+        sub_group_barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+#endif
+
+
+/// time series compression, pass 1: bits and base of every row
+//
+// A row is one species of one trajectory in the species-major samples
+// of ssa_kernel, nrows = NX*count rows of nsamples. The host turns the
+// bits into word offsets (prefix sum) for pass 2.
+__kernel void ssa_pack_bits_kernel(__global const int* samples, const unsigned int nrows,
+                                   const unsigned int nsamples, __global uint* bits,
+                                   __global int* base)
+{
+    size_t r = get_global_id(0);
+    if (r >= nrows) return;
+
+    bits[r] = ssa_pack_bits(samples + r*nsamples, nsamples);
+    base[r] = samples[r*nsamples];
+}
+
+/// time series compression, pass 2: pack every row at its word offset
+//
+// Rows are packed back to back, so only the packed words are read back.
+__kernel void ssa_pack_kernel(__global const int* samples, const unsigned int nrows,
+                              const unsigned int nsamples, __global const uint* bits,
+                              __global const uint* offsets, __global uint* packed)
+{
+    size_t r = get_global_id(0);
+    if (r >= nrows) return;
+
+    ssa_pack_row(samples + r*nsamples, nsamples, bits[r], packed + offsets[r]);
+}
+
+
+/// coupled finite difference (CFD) kernel
+//
+// Anderson, "An efficient finite difference method for parameter
+// sensitivities of continuous time Markov chains", SIAM J. Numer. Anal.
+// 50(5), 2012. Trajectory t runs a nominal process X with the rates of
+// row t / nrep of rates and a perturbed process Y with the rates that
+// follow them in the same row (2*NCHANNEL floats per row), coupled by
+// splitting every channel k into three channels:
+//   min(a_k(X), a_k(Y))  fires in both,
+//   a_k(X) - min         fires in X only,
+//   a_k(Y) - min         fires in Y only,
+// so X and Y stay close and Y - X has a small variance. The 3*NCHANNEL
+// channels are simulated with the direct method and one stream per
+// trajectory, the same (seed, trajectory) stream as ssa_kernel.
+__kernel void ssa_cfd_kernel(__global int* x, __global float* ftime,
+                             const unsigned int count, const ulong seed, const ulong traj_base,
+                             __global int* counters,
+                             __global const float* rates, const unsigned int nrep,
+                             const unsigned int span, __global int* y,
+                             __global ssa_rng_t* rng_state)
+{
+    size_t tid = get_global_id(0);
+    if (tid >= count) return;
+
+    const int nu[DIMX_NU][DIMY_NU] = {{-1, 1, 0}, {1, -1, -1}, {0, 0, 1}}; // same model as ssa_kernel
+    const ulong traj = ssa_traj(tid, traj_base, nrep, span);
+    const ulong set = traj / nrep;
+    float kx[NCHANNEL], ky[NCHANNEL];
+    int sx[NX], sy[NX];
+    float a[3*NCHANNEL];
+    float curTime = 0.0f;
+    float rand1, rexp;
+    int counter = 0;
+
+    for (int c=0; c<NCHANNEL; c++) {
+        kx[c] = rates[set*2*NCHANNEL+c];
+        ky[c] = rates[set*2*NCHANNEL+NCHANNEL+c];
+    }
+    for (int i=0; i<NX; i++) sx[i] = sy[i] = x[NX*tid+i];
+
+    ssa_rng_t rng;
+    ssa_rng_start(&rng, rng_state, tid, seed, traj);
+
+    while (curTime <= FINALTIME) {
+        float ax[NCHANNEL], ay[NCHANNEL], a0 = 0.0f, f, jsum;
+        int rxn = -1;
+
+        counter++;
+
+        ax[0] = sx[0]*kx[0]; ax[1] = sx[1]*kx[1]; ax[2] = sx[1]*kx[2];
+        ay[0] = sy[0]*ky[0]; ay[1] = sy[1]*ky[1]; ay[2] = sy[1]*ky[2];
+        for (int c=0; c<NCHANNEL; c++) {
+            float m = fmin(ax[c], ay[c]);
+            a[3*c]   = m;
+            a[3*c+1] = ax[c] - m;
+            a[3*c+2] = ay[c] - m;
+            a0 += ax[c] + ay[c] - m;
+        }
+        if (a0 <= 0.0f) break;  // both processes absorbed
+
+        ssa_rng_draw2(&rng, &rand1, &rexp);
+
+        // choose one of the split channels; only channels with a positive
+        // rate can be chosen, even if rounding leaves jsum just below f
+        f = rand1 * a0;
+        jsum = 0.0f;
+        for (int r=0; r<3*NCHANNEL; r++) {
+            if (a[r] > 0.0f) {
+                rxn = r;
+                jsum += a[r];
+                if (jsum >= f) break;
+            }
+        }
+
+        const int c = rxn / 3, which = rxn % 3;
+        if (which != 2) for (int i=0; i<NX; i++) sx[i] += nu[i][c];
+        if (which != 1) for (int i=0; i<NX; i++) sy[i] += nu[i][c];
+
+        curTime += rexp / a0;
+    }
+
     ftime[tid] = curTime;
     counters[tid] = counter;
-    for (int i=0; i<NX; i++) x[xBegin+i] = xShared[xSharedBegin+i];
+    for (int i=0; i<NX; i++) {
+        x[NX*tid+i] = sx[i];
+        y[NX*tid+i] = sy[i];
+    }
 }
-
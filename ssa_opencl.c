@@ -24,8 +24,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-//#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
 
 #define CL_USE_DEPRECATED_OPENCL_1_2_APIS  // suppress deprecation warning for clCreateCommandQueue
 //#include <CL/opencl.h>
@@ -40,19 +45,484 @@
 
 /* problem parameters and cuda threads launch geometry */
 #include "prob_params.h"
+#include "tinymt32j_states.h"
+#include "tinymt32wp_params.h"
+#include "ssa_sweep.h"
+#include "ssa_stats.h"
+#include "ssa_checkpoint.h"
+#include "ssa_store.h"
+#include "ssa_pack.h"
+#include "ssa_tail.h"
 
 #define PROGRAM_FILE "ssa_kernel.cl"
 #define KERNEL_FUNC "ssa_kernel"
+#define KERNEL_SG_FUNC "ssa_sg_kernel"      // one trajectory per sub-group (--kernel subgroup)
+#define KERNEL_CFD_FUNC "ssa_cfd_kernel"    // coupled finite differences (--sensitivity)
+#define KERNEL_PACK_BITS_FUNC "ssa_pack_bits_kernel"    // time series compression (--pack)
+#define KERNEL_PACK_FUNC "ssa_pack_kernel"
+#define PARAMS_CACHE_DIR "."    // where parsed SSA_RNG_TINYMT_WP parameter sets are cached
+#define TINYMT_PARAMS_FILE "TinyMT/opencl/tinymt32dc.0.2000.txt"  // SSA_RNG_TINYMT_WP parameter sets
 
 static const int x[NX] = {1200, 600, 0};
+static const float proprates[NCHANNEL] = {1.0f, 2.0f, 0.00005f};   // nominal rate constants
 
-static void init_x_array(int *xarr)
+#define MAX_GRID_AXES NCHANNEL
+#define CI_Z 1.96               // 95% normal confidence intervals
+#define CHECKPOINT_SLICE_STEPS (1 << 20)    // default --max-steps when checkpointing
+#define CHECKPOINT_INTERVAL 600.0           // default --checkpoint-interval [s]
+#define TAIL_SLICE_STEPS (1 << 16)          // default --max-steps with --tail-offload
+#define BUDGET_WARN 0.8                     // --budget fraction an estimate is warned at
+
+/* long options without a short form */
+enum {
+    OPT_CHECKPOINT_INTERVAL = 256,
+    OPT_MAX_STEPS,
+    OPT_RESUME,
+    OPT_STORE,
+    OPT_SAMPLES,
+    OPT_PACK,
+    OPT_TINYMT_PARAMS,
+    OPT_STATE_CACHE,
+    OPT_COST_ORDER,
+    OPT_ITEMS_PER_WI,
+    OPT_KERNEL,
+    OPT_TAIL_OFFLOAD,
+    OPT_TAIL_THREADS,
+    OPT_DEVICE,
+    OPT_NUMA,
+    OPT_PROGRESS,
+    OPT_PILOT,
+    OPT_LAUNCH_LIMIT,
+    OPT_BUDGET,
+    OPT_KERNEL_INFO
+};
+
+/* trajectory kernel (--kernel) */
+enum {
+    KERNEL_AUTO,            // by NCHANNEL and the device
+    KERNEL_ITEM,            // ssa_kernel, trajectories per work item
+    KERNEL_SUBGROUP         // ssa_sg_kernel, one trajectory per sub-group
+};
+
+static void init_x_array(int *xarr, size_t n)
 {
-    for (int i=0; i<NTHREADS; i++)
+    for (size_t i=0; i<n; i++)
         for (int j=0; j<NX; j++) 
             xarr[NX*i+j] = x[j];
 }
 
+/* command line options */
+struct ssa_options {
+    cl_ulong seed;          // 64-bit run seed
+    int seed_given;         // --seed was given (else taken from the checkpoint)
+    size_t nrep;            // trajectories (replicates) per parameter set
+    cl_ulong first;         // index of the first trajectory of this run
+    size_t ntraj;           // number of trajectories of this run (0: to the end)
+    size_t batch;           // trajectories per kernel launch
+    int batch_given;
+    int print;              // print per-trajectory results
+    const char *sweep_file; // parameter sets, one per line
+    char *grid[MAX_GRID_AXES];  // grid axes CH=LO:HI:N[:log]
+    int ngrid;
+    int sens;               // coupled finite difference sensitivities
+    int sens_channel[NCHANNEL]; // rate constants to differentiate by
+    double sens_step;       // relative perturbation of a rate constant
+    int output[NX];         // species reported (and targeted by --ci-target)
+    int adaptive;           // run rounds until a stopping rule holds
+    double ci_target;       // confidence interval half width to stop at
+    double time_budget;     // wall time budget [s]
+    size_t round_reps;      // replicates per set and round (0: N/16)
+    const char *checkpoint; // checkpoint file
+    double checkpoint_interval; // wall time between checkpoints [s]
+    cl_uint max_steps;      // steps per item and launch slice (0: unsliced)
+    int max_steps_given;
+    int resume;             // continue from the checkpoint file
+    const char *store;      // columnar result file
+    cl_uint nsamples;       // time series samples per trajectory
+    int pack;               // compress the time series on the device
+    const char *tinymt_params;  // TinyMT parameter sets, one per trajectory
+    const char *state_cache;    // directory caching TinyMT start states (NULL: none)
+    int cost_order;         // group launch items of similar expected cost
+    cl_uint items_per_wi;   // trajectories a work item of ssa_kernel steps in turn
+    int kernel;             // KERNEL_AUTO, KERNEL_ITEM or KERNEL_SUBGROUP
+    double tail_fraction;   // finish a launch on the host below this active fraction
+    int tail_threads;       // host threads finishing a launch
+    cl_device_type device_type; // device to run on
+    int numa;               // one sub-device per NUMA node
+    double progress_interval;   // seconds between progress reports (0: none)
+    size_t pilot;           // trajectories of the pilot run (0: none)
+    double launch_limit;    // kernel time per launch or slice [s] (0: no limit)
+    double budget;          // kernel time of the run [s] (0: no limit)
+    const char *kernel_info;    // kernel resource report file ("-": stdout)
+};
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [options]\n", prog);
+    printf("  -s, --seed N          64-bit run seed (default: time)\n");
+    printf("  -n, --trajectories N  trajectories per parameter set (default: %d)\n", NTHREADS);
+    printf("  -f, --first N         index of the first trajectory to run (default: 0)\n");
+    printf("  -c, --count N         number of trajectories to run (default: all)\n");
+    printf("  -b, --batch N         trajectories per kernel launch (default: all)\n");
+    printf("  -w, --sweep FILE      parameter sets to run, %d rate constants per line\n", NCHANNEL);
+    printf("  -g, --grid CH=LO:HI:N[:log]\n");
+    printf("                        sweep channel CH over N values (repeatable)\n");
+    printf("  -S, --sensitivity CH[,CH...]|all\n");
+    printf("                        estimate d E[x] / d rate of the given channels with\n");
+    printf("                        coupled finite differences, one parameter set per\n");
+    printf("                        (rate set, channel) pair\n");
+    printf("  -d, --step H          relative perturbation of the rates (default: 0.01)\n");
+    printf("  -o, --outputs SP[,SP...]|all\n");
+    printf("                        species reported and targeted (default: all)\n");
+    printf("  -e, --ci-target W     stop once every output's 95%% confidence interval\n");
+    printf("                        half width is at most W (N is then the maximum)\n");
+    printf("  -t, --time-budget S   stop before a round would exceed S seconds\n");
+    printf("  -r, --round N         replicates per set and round (default: N/16)\n");
+    printf("  -k, --checkpoint FILE write a checkpoint to FILE periodically\n");
+    printf("      --checkpoint-interval S\n");
+    printf("                        seconds between checkpoints (default: %g)\n", CHECKPOINT_INTERVAL);
+    printf("      --max-steps N     steps per trajectory and kernel launch, 0: no limit\n");
+    printf("                        (default: %d with --checkpoint, else 0)\n", CHECKPOINT_SLICE_STEPS);
+    printf("      --resume          continue the run saved in the checkpoint file\n");
+    printf("      --store FILE      write every trajectory to the columnar file FILE\n");
+    printf("      --samples K       also store the state at K evenly spaced times\n");
+    printf("      --pack            delta, zigzag and bit-pack the time series on the\n");
+    printf("                        device before it is read back and stored\n");
+    printf("      --tinymt-params FILE\n");
+    printf("                        tinymt32dc output, one parameter set per trajectory\n");
+    printf("                        (SSA_RNG_TINYMT_WP builds, default: %s)\n", TINYMT_PARAMS_FILE);
+    printf("      --state-cache DIR keep the TinyMT start states of every launch in DIR\n");
+    printf("                        for runs of the same seed and range (SSA_RNG_TINYMT\n");
+    printf("                        builds, default: no cache)\n");
+    printf("      --cost-order      run the items of a launch sorted by expected steps,\n");
+    printf("                        so a work group holds trajectories of similar cost\n");
+    printf("      --items-per-wi K  trajectories a work item steps in turn, 1..%d\n", SSA_MAX_ITEMS_PER_WI);
+    printf("                        (default: %d; tune per device)\n", SSA_ITEMS_PER_WI);
+    printf("      --kernel item|subgroup|auto\n");
+    printf("                        one trajectory per work item or per sub-group; auto\n");
+    printf("                        takes subgroup from %d channels on if the device\n", SSA_SG_MIN_CHANNELS);
+    printf("                        supports it (default: auto, %d channels)\n", NCHANNEL);
+    printf("      --tail-offload F  once at most a fraction F of a launch is running,\n");
+    printf("                        finish it on host threads while the device runs\n");
+    printf("                        the next launch (checked every --max-steps, default\n");
+    printf("                        %d)\n", TAIL_SLICE_STEPS);
+    printf("      --tail-threads N  host threads for --tail-offload (default: all cores)\n");
+    printf("      --device gpu|cpu|all\n");
+    printf("                        OpenCL device type to run on (default: gpu)\n");
+    printf("      --numa            split the device into one sub-device per NUMA node,\n");
+    printf("                        each with its own queue and buffers, and shard\n");
+    printf("                        every launch across them\n");
+    printf("      --progress S      report progress, rate and ETA on stderr every S\n");
+    printf("                        seconds from counters the kernel updates as it runs\n");
+    printf("      --pilot N         first run N trajectories of the range to measure\n");
+    printf("                        the device rate and estimate the run's kernel time\n");
+    printf("      --launch-limit S  with --pilot, size --batch and --max-steps (unless\n");
+    printf("                        given) so a launch or slice takes about S seconds\n");
+    printf("      --budget S        with --pilot, refuse runs estimated above S seconds\n");
+    printf("                        of kernel time, warn from %.0f%% of it on\n", 100*BUDGET_WARN);
+    printf("      --kernel-info FILE\n");
+    printf("                        write the resources and local memory bound of\n");
+    printf("                        every kernel variant on the device as JSON to FILE\n");
+    printf("                        (-: stdout) and exit\n");
+    printf("  -p, --print           print the final state of every trajectory\n");
+    printf("Trajectory t runs replicate t %% N of parameter set t / N. It gives the\n");
+    printf("same result however the run is batched or split with --first/--count\n");
+    printf("across processes and devices.\n");
+}
+
+/* "all" or a comma separated list of indices below n, as flags */
+static void parse_index_list(const char *list, int *flags, int n, const char *what)
+{
+    const char *p = list;
+    char *end;
+
+    for (int i=0; i<n; i++) flags[i] = (strcmp(list, "all") == 0);
+    if (flags[0]) return;
+    while (*p) {
+        long i = strtol(p, &end, 10);
+        if (end == p || i < 0 || i >= n || (*end != ',' && *end != '\0')) {
+            printf("Error: Bad %s list '%s'!\n", what, list);
+            exit(1);
+        }
+        flags[i] = 1;
+        p = (*end == ',') ? end + 1 : end;
+    }
+}
+
+static void parse_options(int argc, char **argv, struct ssa_options *opt)
+{
+    static const struct option longopts[] = {
+        {"seed",         required_argument, NULL, 's'},
+        {"trajectories", required_argument, NULL, 'n'},
+        {"first",        required_argument, NULL, 'f'},
+        {"count",        required_argument, NULL, 'c'},
+        {"batch",        required_argument, NULL, 'b'},
+        {"sweep",        required_argument, NULL, 'w'},
+        {"grid",         required_argument, NULL, 'g'},
+        {"sensitivity",  required_argument, NULL, 'S'},
+        {"step",         required_argument, NULL, 'd'},
+        {"outputs",      required_argument, NULL, 'o'},
+        {"ci-target",    required_argument, NULL, 'e'},
+        {"time-budget",  required_argument, NULL, 't'},
+        {"round",        required_argument, NULL, 'r'},
+        {"checkpoint",   required_argument, NULL, 'k'},
+        {"checkpoint-interval", required_argument, NULL, OPT_CHECKPOINT_INTERVAL},
+        {"max-steps",    required_argument, NULL, OPT_MAX_STEPS},
+        {"resume",       no_argument,       NULL, OPT_RESUME},
+        {"store",        required_argument, NULL, OPT_STORE},
+        {"samples",      required_argument, NULL, OPT_SAMPLES},
+        {"pack",         no_argument,       NULL, OPT_PACK},
+        {"tinymt-params", required_argument, NULL, OPT_TINYMT_PARAMS},
+        {"state-cache",  required_argument, NULL, OPT_STATE_CACHE},
+        {"cost-order",   no_argument,       NULL, OPT_COST_ORDER},
+        {"items-per-wi", required_argument, NULL, OPT_ITEMS_PER_WI},
+        {"kernel",       required_argument, NULL, OPT_KERNEL},
+        {"tail-offload", required_argument, NULL, OPT_TAIL_OFFLOAD},
+        {"tail-threads", required_argument, NULL, OPT_TAIL_THREADS},
+        {"device",       required_argument, NULL, OPT_DEVICE},
+        {"numa",         no_argument,       NULL, OPT_NUMA},
+        {"progress",     required_argument, NULL, OPT_PROGRESS},
+        {"pilot",        required_argument, NULL, OPT_PILOT},
+        {"launch-limit", required_argument, NULL, OPT_LAUNCH_LIMIT},
+        {"budget",       required_argument, NULL, OPT_BUDGET},
+        {"kernel-info",  required_argument, NULL, OPT_KERNEL_INFO},
+        {"print",        no_argument,       NULL, 'p'},
+        {"help",         no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int c;
+
+    opt->seed = (cl_ulong) time(NULL);
+    opt->seed_given = 0;
+    opt->nrep = NTHREADS;
+    opt->first = 0;
+    opt->ntraj = 0;
+    opt->batch = 0;
+    opt->batch_given = 0;
+    opt->print = 0;
+    opt->sweep_file = NULL;
+    opt->ngrid = 0;
+    opt->sens = 0;
+    opt->sens_step = 0.01;
+    for (int j=0; j<NX; j++) opt->output[j] = 1;
+    opt->adaptive = 0;
+    opt->ci_target = 0.0;
+    opt->time_budget = 0.0;
+    opt->round_reps = 0;
+    opt->checkpoint = NULL;
+    opt->checkpoint_interval = CHECKPOINT_INTERVAL;
+    opt->max_steps = 0;
+    opt->max_steps_given = 0;
+    opt->resume = 0;
+    opt->store = NULL;
+    opt->nsamples = 0;
+    opt->pack = 0;
+    opt->tinymt_params = TINYMT_PARAMS_FILE;
+    opt->state_cache = NULL;
+    opt->cost_order = 0;
+    opt->items_per_wi = SSA_ITEMS_PER_WI;
+    opt->kernel = KERNEL_AUTO;
+    opt->tail_fraction = 0.0;
+    opt->tail_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    opt->device_type = CL_DEVICE_TYPE_GPU;
+    opt->numa = 0;
+    opt->progress_interval = 0.0;
+    opt->pilot = 0;
+    opt->launch_limit = 0.0;
+    opt->budget = 0.0;
+    opt->kernel_info = NULL;
+
+    while ((c = getopt_long(argc, argv, "s:n:f:c:b:w:g:S:d:o:e:t:r:k:ph", longopts, NULL)) != -1) {
+        switch (c) {
+        case 's': opt->seed = strtoull(optarg, NULL, 0); opt->seed_given = 1; break;
+        case 'n': opt->nrep = strtoull(optarg, NULL, 0); break;
+        case 'f': opt->first = strtoull(optarg, NULL, 0); break;
+        case 'c': opt->ntraj = strtoull(optarg, NULL, 0); break;
+        case 'b': opt->batch = strtoull(optarg, NULL, 0); opt->batch_given = 1; break;
+        case 'w': opt->sweep_file = optarg; break;
+        case 'g':
+            if (opt->ngrid == MAX_GRID_AXES) {
+                printf("Error: At most %d grid axes!\n", MAX_GRID_AXES);
+                exit(1);
+            }
+            opt->grid[opt->ngrid++] = optarg;
+            break;
+        case 'S':
+            opt->sens = 1;
+            parse_index_list(optarg, opt->sens_channel, NCHANNEL, "channel");
+            break;
+        case 'd': opt->sens_step = strtod(optarg, NULL); break;
+        case 'o': parse_index_list(optarg, opt->output, NX, "species"); break;
+        case 'e': opt->ci_target = strtod(optarg, NULL); opt->adaptive = 1; break;
+        case 't': opt->time_budget = strtod(optarg, NULL); opt->adaptive = 1; break;
+        case 'r': opt->round_reps = strtoull(optarg, NULL, 0); opt->adaptive = 1; break;
+        case 'k': opt->checkpoint = optarg; break;
+        case OPT_CHECKPOINT_INTERVAL: opt->checkpoint_interval = strtod(optarg, NULL); break;
+        case OPT_MAX_STEPS:
+            opt->max_steps = (cl_uint) strtoul(optarg, NULL, 0);
+            opt->max_steps_given = 1;
+            break;
+        case OPT_RESUME: opt->resume = 1; break;
+        case OPT_STORE: opt->store = optarg; break;
+        case OPT_SAMPLES: opt->nsamples = (cl_uint) strtoul(optarg, NULL, 0); break;
+        case OPT_PACK: opt->pack = 1; break;
+        case OPT_TINYMT_PARAMS: opt->tinymt_params = optarg; break;
+        case OPT_STATE_CACHE: opt->state_cache = optarg; break;
+        case OPT_COST_ORDER: opt->cost_order = 1; break;
+        case OPT_ITEMS_PER_WI: opt->items_per_wi = (cl_uint) strtoul(optarg, NULL, 0); break;
+        case OPT_KERNEL:
+            if (strcmp(optarg, "item") == 0) opt->kernel = KERNEL_ITEM;
+            else if (strcmp(optarg, "subgroup") == 0) opt->kernel = KERNEL_SUBGROUP;
+            else if (strcmp(optarg, "auto") == 0) opt->kernel = KERNEL_AUTO;
+            else {
+                printf("Error: Bad --kernel '%s'!\n", optarg);
+                exit(1);
+            }
+            break;
+        case OPT_TAIL_OFFLOAD: opt->tail_fraction = strtod(optarg, NULL); break;
+        case OPT_TAIL_THREADS: opt->tail_threads = atoi(optarg); break;
+        case OPT_DEVICE:
+            if (strcmp(optarg, "gpu") == 0) opt->device_type = CL_DEVICE_TYPE_GPU;
+            else if (strcmp(optarg, "cpu") == 0) opt->device_type = CL_DEVICE_TYPE_CPU;
+            else if (strcmp(optarg, "all") == 0) opt->device_type = CL_DEVICE_TYPE_ALL;
+            else {
+                printf("Error: Bad --device '%s'!\n", optarg);
+                exit(1);
+            }
+            break;
+        case OPT_NUMA: opt->numa = 1; break;
+        case OPT_PROGRESS: opt->progress_interval = strtod(optarg, NULL); break;
+        case OPT_PILOT: opt->pilot = strtoull(optarg, NULL, 0); break;
+        case OPT_LAUNCH_LIMIT: opt->launch_limit = strtod(optarg, NULL); break;
+        case OPT_BUDGET: opt->budget = strtod(optarg, NULL); break;
+        case OPT_KERNEL_INFO: opt->kernel_info = optarg; break;
+        case 'p': opt->print = 1; break;
+        case 'h': usage(argv[0]); exit(0);
+        default:  usage(argv[0]); exit(1);
+        }
+    }
+    if (opt->nrep == 0 || opt->nrep > UINT32_MAX) {
+        printf("Error: Bad number of trajectories per parameter set!\n");
+        exit(1);
+    }
+    if (opt->items_per_wi < 1 || opt->items_per_wi > SSA_MAX_ITEMS_PER_WI) {
+        printf("Error: --items-per-wi must be in 1..%d!\n", SSA_MAX_ITEMS_PER_WI);
+        exit(1);
+    }
+    if (opt->kernel == KERNEL_SUBGROUP && opt->sens) {
+        printf("Error: --sensitivity runs ssa_cfd_kernel, not --kernel subgroup!\n");
+        exit(1);
+    }
+    if (opt->sweep_file && opt->ngrid > 0) {
+        printf("Error: --sweep and --grid are exclusive!\n");
+        exit(1);
+    }
+    if (opt->adaptive && (opt->first != 0 || opt->ntraj != 0)) {
+        printf("Error: --first/--count cannot be combined with adaptive runs!\n");
+        exit(1);
+    }
+    if (opt->checkpoint && (opt->adaptive || opt->sens)) {
+        printf("Error: --checkpoint supports fixed-size runs of ssa_kernel only!\n");
+        exit(1);
+    }
+    if (opt->tail_fraction < 0.0 || opt->tail_fraction >= 1.0) {
+        printf("Error: --tail-offload must be a fraction in [0, 1)!\n");
+        exit(1);
+    }
+    if (opt->tail_fraction > 0.0 && (opt->checkpoint || opt->sens)) {
+        printf("Error: --tail-offload supports ssa_kernel runs without --checkpoint only!\n");
+        exit(1);
+    }
+#if SSA_LOG_MODE != SSA_LOG_FULL
+    // the host has logf only, which may be far more precise than native_log and half_log
+    if (opt->tail_fraction > 0.0) {
+        printf("Error: --tail-offload needs SSA_LOG_MODE SSA_LOG_FULL, so host and device draw waiting times alike!\n");
+        exit(1);
+    }
+#endif
+    if (opt->tail_threads < 1) opt->tail_threads = 1;
+    if (opt->progress_interval < 0.0 || (opt->progress_interval > 0.0 && opt->sens)) {
+        printf("Error: --progress needs a positive interval and ssa_kernel!\n");
+        exit(1);
+    }
+    if (opt->launch_limit < 0.0 || opt->budget < 0.0) {
+        printf("Error: --launch-limit and --budget must not be negative!\n");
+        exit(1);
+    }
+    if ((opt->launch_limit > 0.0 || opt->budget > 0.0) && opt->pilot == 0) {
+        printf("Error: --launch-limit and --budget need --pilot N!\n");
+        exit(1);
+    }
+    if (opt->pilot > 0 && (opt->adaptive || opt->resume)) {
+        printf("Error: --pilot supports fixed-size runs without --resume only!\n");
+        exit(1);
+    }
+    if (opt->resume && !opt->checkpoint) {
+        printf("Error: --resume needs --checkpoint FILE!\n");
+        exit(1);
+    }
+    if (opt->nsamples > 0 && (!opt->store || opt->sens)) {
+        printf("Error: --samples needs --store FILE and ssa_kernel!\n");
+        exit(1);
+    }
+    if (opt->pack && opt->nsamples == 0) {
+        printf("Error: --pack needs --samples K!\n");
+        exit(1);
+    }
+    if (opt->checkpoint && !opt->max_steps_given) opt->max_steps = CHECKPOINT_SLICE_STEPS;
+    if (opt->tail_fraction > 0.0 && !opt->max_steps_given) opt->max_steps = TAIL_SLICE_STEPS;
+    if (opt->sens && !(opt->sens_step > 0.0)) {
+        printf("Error: The sensitivity step must be positive!\n");
+        exit(1);
+    }
+}
+
+/* rate table of the run: nominal rates, a sweep file or a grid */
+static float *get_rate_table(const struct ssa_options *opt, size_t *nsets)
+{
+    float *rates;
+
+    if (opt->sweep_file) {
+        rates = ssa_sweep_load(opt->sweep_file, nsets);
+    } else if (opt->ngrid > 0) {
+        rates = ssa_sweep_grid(proprates, (char **) opt->grid, opt->ngrid, nsets);
+    } else {
+        rates = (float *) malloc(sizeof(proprates));
+        memcpy(rates, proprates, sizeof(proprates));
+        *nsets = 1;
+    }
+    if (!rates) exit(1);
+    return rates;
+}
+
+/*
+ * Coupled finite difference table: for every rate set s and every
+ * channel k to differentiate by, one row holding the nominal rates of s
+ * followed by the same rates with rate k scaled by 1 + step.
+ * Row s * nsens + i perturbs the i-th selected channel of set s.
+ */
+static float *get_cfd_table(const struct ssa_options *opt, const float *rates,
+                            size_t nsets, int *channels, size_t *nrows)
+{
+    int nsens = 0;
+    float *table;
+
+    for (int c=0; c<NCHANNEL; c++)
+        if (opt->sens_channel[c]) channels[nsens++] = c;
+
+    table = (float *) malloc(sizeof(float) * 2 * NCHANNEL * nsets * nsens);
+    for (size_t s=0; s<nsets; s++) {
+        for (int i=0; i<nsens; i++) {
+            float *row = table + (s * nsens + i) * 2 * NCHANNEL;
+            memcpy(row, rates + s * NCHANNEL, sizeof(float) * NCHANNEL);
+            memcpy(row + NCHANNEL, rates + s * NCHANNEL, sizeof(float) * NCHANNEL);
+            row[NCHANNEL + channels[i]] *= (float) (1.0 + opt->sens_step);
+        }
+    }
+    *nrows = nsets * nsens;
+    return table;
+}
+
 // CL_CHECK copied from http://svn.clifford.at/tools/trunk/examples/cldemo.c
 #define CL_CHECK(_expr)                                                         \
    do {                                                                         \
@@ -68,7 +538,8 @@ static void init_x_array(int *xarr)
 /* Create program from a file and compile it */
 // copied from OpenCL in Action 
 // https://github.com/jeremyong/opencl_in_action/blob/master/Ch11/bsort8/bsort8.c
-cl_program build_program(cl_context ctx, cl_device_id dev, const char* filename) {
+cl_program build_program(cl_context ctx, cl_device_id dev, const char* filename,
+                         const char* options) {
 
     cl_program program;
     FILE *program_handle;
@@ -100,7 +571,7 @@ cl_program build_program(cl_context ctx, cl_device_id dev, const char* filename)
     free(program_buffer);
 
     /* Build program */
-    err = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
+    err = clBuildProgram(program, 0, NULL, options, NULL, NULL);
     if(err < 0) {
 
         /* Find size of log and print to std output */
@@ -118,22 +589,1475 @@ cl_program build_program(cl_context ctx, cl_device_id dev, const char* filename)
     return program;
 }
 
+/* sub-groups in OpenCL C: cl_khr_subgroups, or core in OpenCL 2.1 and 2.2 */
+static int device_has_subgroups(cl_device_id dev)
+{
+    char buf[8192];
+
+    if (clGetDeviceInfo(dev, CL_DEVICE_EXTENSIONS, sizeof(buf), buf, NULL) == CL_SUCCESS
+        && strstr(buf, "cl_khr_subgroups"))
+        return 1;
+    return clGetDeviceInfo(dev, CL_DEVICE_VERSION, sizeof(buf), buf, NULL) == CL_SUCCESS
+        && (strncmp(buf, "OpenCL 2.1", 10) == 0 || strncmp(buf, "OpenCL 2.2", 10) == 0);
+}
+
+/* s as a JSON string */
+static void json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fprintf(out, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20) fprintf(out, "\\u%04x", *s);
+        else fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+/* kernel variants of --kernel-info, consecutive ones of the same build share it */
+static const struct kernel_variant {
+    const char *name;
+    cl_uint items_per_wi;   // -DSSA_ITEMS_PER_WI
+    int progress;           // -DSSA_PROGRESS
+    int subgroup;           // -DSSA_SG_KERNEL, needs sub-groups
+} kernel_variants[] = {
+    {KERNEL_FUNC, 1, 0, 0},
+    {KERNEL_CFD_FUNC, 1, 0, 0},
+    {KERNEL_PACK_BITS_FUNC, 1, 0, 0},
+    {KERNEL_PACK_FUNC, 1, 0, 0},
+    {KERNEL_FUNC, 2, 0, 0},
+    {KERNEL_FUNC, 4, 0, 0},
+    {KERNEL_FUNC, 8, 0, 0},
+    {KERNEL_FUNC, 1, 1, 0},
+    {KERNEL_SG_FUNC, 1, 0, 1},
+};
+
+/*
+ * --kernel-info: builds every kernel variant for dev and writes what
+ * clGetKernelWorkGroupInfo reports of it, with the device limits, as
+ * JSON to out. OpenCL reports no per compute unit residency (work
+ * items, registers), so no occupancy is given: only the bound on
+ * concurrent groups that local memory alone sets, and the private
+ * memory a group of the launch size takes, for the reader to weigh
+ * against the device's register file. OpenCL has no query for the
+ * constant memory of a kernel, so only the device limits are given.
+ */
+static void write_kernel_info(FILE *out, cl_context context, cl_device_id dev)
+{
+    char name[256], vendor[256], version[256];
+    cl_uint units, const_args;
+    size_t max_group, max_items[3] = {0, 0, 0};
+    cl_ulong local_mem, const_size, global_mem;
+    cl_program program = NULL;
+    char options[128] = "";
+    const size_t local_size = XBLOCKSIZE;   // what the kernels are launched with
+    int first = 1;
+
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_NAME, sizeof(name), name, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_VENDOR, sizeof(vendor), vendor, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_VERSION, sizeof(version), version, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(units), &units, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_group), &max_group, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(max_items), max_items, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(global_mem), &global_mem, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(local_mem), &local_mem, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(const_size), &const_size, NULL));
+    CL_CHECK(clGetDeviceInfo(dev, CL_DEVICE_MAX_CONSTANT_ARGS, sizeof(const_args), &const_args, NULL));
+
+    fprintf(out, "{\n  \"device\": {\"name\": ");
+    json_string(out, name);
+    fprintf(out, ", \"vendor\": ");
+    json_string(out, vendor);
+    fprintf(out, ", \"version\": ");
+    json_string(out, version);
+    fprintf(out, ",\n    \"compute_units\": %u, \"max_work_group_size\": %zu, \"max_work_item_sizes\": [%zu, %zu, %zu],\n"
+            "    \"global_mem_size\": %llu, \"local_mem_size\": %llu,\n"
+            "    \"max_constant_buffer_size\": %llu, \"max_constant_args\": %u},\n",
+            units, max_group, max_items[0], max_items[1], max_items[2], (unsigned long long) global_mem,
+            (unsigned long long) local_mem, (unsigned long long) const_size, const_args);
+    fprintf(out, "  \"nx\": %d, \"nchannel\": %d, \"local_size\": %zu,\n  \"kernels\": [", NX, NCHANNEL, local_size);
+
+    for (size_t v=0; v<sizeof(kernel_variants)/sizeof(kernel_variants[0]); v++) {
+        const struct kernel_variant *kv = &kernel_variants[v];
+        char variant_options[128];
+        size_t group_size, multiple, compile_size[3];
+        cl_ulong kernel_local, kernel_private;
+        cl_kernel kernel;
+        cl_int err;
+
+        if (kv->subgroup && !device_has_subgroups(dev)) continue;
+        snprintf(variant_options, sizeof(variant_options), "-DSSA_ITEMS_PER_WI=%u -DSSA_PROGRESS=%d%s",
+                 kv->items_per_wi, kv->progress, kv->subgroup ? " -DSSA_SG_KERNEL=1 -cl-std=CL2.0" : "");
+        if (!program || strcmp(options, variant_options) != 0) {
+            if (program) CL_CHECK(clReleaseProgram(program));
+            strcpy(options, variant_options);
+            program = build_program(context, dev, PROGRAM_FILE, options);
+        }
+        kernel = clCreateKernel(program, kv->name, &err);
+        if (!kernel || err != CL_SUCCESS) {
+            printf("Error: Failed to create compute kernel (%s)!\n", kv->name);
+            exit(1);
+        }
+        CL_CHECK(clGetKernelWorkGroupInfo(kernel, dev, CL_KERNEL_WORK_GROUP_SIZE,
+                    sizeof(group_size), &group_size, NULL));
+        CL_CHECK(clGetKernelWorkGroupInfo(kernel, dev, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                    sizeof(multiple), &multiple, NULL));
+        CL_CHECK(clGetKernelWorkGroupInfo(kernel, dev, CL_KERNEL_COMPILE_WORK_GROUP_SIZE,
+                    sizeof(compile_size), compile_size, NULL));
+        CL_CHECK(clGetKernelWorkGroupInfo(kernel, dev, CL_KERNEL_LOCAL_MEM_SIZE,
+                    sizeof(kernel_local), &kernel_local, NULL));
+        CL_CHECK(clGetKernelWorkGroupInfo(kernel, dev, CL_KERNEL_PRIVATE_MEM_SIZE,
+                    sizeof(kernel_private), &kernel_private, NULL));
+        CL_CHECK(clReleaseKernel(kernel));
+
+        // groups of local_size that local memory alone allows at once on a
+        // compute unit (none without local memory); other limits are unknown
+        char local_bound[32] = "null";
+        if (kernel_local > 0)
+            snprintf(local_bound, sizeof(local_bound), "%llu", (unsigned long long) (local_mem / kernel_local));
+
+        fprintf(out, "%s\n    {\"kernel\": ", first ? "" : ",");
+        json_string(out, kv->name);
+        fprintf(out, ", \"build_options\": ");
+        json_string(out, options);
+        fprintf(out, ",\n     \"items_per_wi\": %u, \"progress\": %s, \"subgroup\": %s,\n"
+                "     \"work_group_size\": %zu, \"preferred_work_group_size_multiple\": %zu,\n"
+                "     \"compile_work_group_size\": [%zu, %zu, %zu],\n"
+                "     \"local_mem_size\": %llu, \"private_mem_size\": %llu,\n"
+                "     \"local_size_fits\": %s, \"local_size_is_multiple\": %s,\n"
+                "     \"private_mem_per_group\": %llu, \"groups_per_cu_local_mem_bound\": %s}",
+                kv->items_per_wi, kv->progress ? "true" : "false", kv->subgroup ? "true" : "false",
+                group_size, multiple, compile_size[0], compile_size[1], compile_size[2],
+                (unsigned long long) kernel_local, (unsigned long long) kernel_private,
+                local_size <= group_size ? "true" : "false",
+                multiple > 0 && local_size % multiple == 0 ? "true" : "false",
+                (unsigned long long) (kernel_private * local_size), local_bound);
+        first = 0;
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (program) CL_CHECK(clReleaseProgram(program));
+}
+
+/*
+ * A (sub-)device of the run with its own queue, kernel and buffers, and
+ * its share of the launch in flight: items offset..offset+count-1 of
+ * the launch, a launch of their own starting at trajectory traj_base.
+ */
+struct ssa_part {
+    cl_device_id device;
+    cl_command_queue queue;
+    cl_kernel kernel;
+    cl_mem x_d, ftime_d, counters_d, y_d, done_d, rng_d, samples_d;
+    cl_mem order_d;         // launch item of every work item (ssa_kernel)
+    cl_uint offset, count;
+    cl_ulong traj_base;
+    cl_event event;         // kernel in flight
+    cl_mem progress_d;      // SSA_PROGRESS_WORDS counters (--progress)
+    cl_command_queue monitor_queue; // maps progress_d while the kernel runs
+};
+
+/* progress counters of the device and the thread reporting them (--progress) */
+struct ssa_progress {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int stop;
+    double start;           // wall time of the first report interval
+    cl_ulong total;         // trajectories of the run (at most, adaptive runs)
+    cl_ulong resumed;       // of them finished before --resume
+    cl_ulong launch0;       // finished on the device before the launch in flight
+    cl_ulong done0;         // finished on the device or host threads by then
+    cl_ulong steps0;        // steps taken by then, device and host
+    cl_uint count;          // items of the launch in flight
+};
+
+/* device buffers, host staging arrays and ensemble statistics of a run */
+struct ssa_run {
+    const struct ssa_options *opt;
+    struct ssa_part *part;  // one per NUMA node with --numa, else one
+    int nparts;
+    cl_uint count;          // items of the launch in flight
+    int *x_h, *y_h, *counters_h, *done_h;   // one launch worth of results
+    float *ftime_h;
+    uint32_t *rng_h;        // SSA_RNG_STATE_WORDS per item
+    const uint32_t *tinymt_params;  // TINYMT32WP_PARAM_WORDS per trajectory (SSA_RNG_TINYMT_WP)
+    const float *rates;     // rate constants, NCHANNEL per set
+    struct launch_item_cost *cost_h;    // --cost-order
+    cl_uint *order_h;
+    int *samples_h;         // NX * count * nsamples, species-major
+    int *column_h;          // one store column of a launch
+    cl_kernel pack_bits_kernel, pack_kernel;    // --pack
+    cl_mem bits_d, base_d, offsets_d, packed_d;
+    cl_uint *bits_h, *offsets_h, *packed_h;     // per row (species of a trajectory)
+    int *base_h;
+    cl_uint packed_words;   // packed words of the launch
+    size_t nsets;
+    int nobs;               // observables per parameter set
+    ssa_stats_t *stats;     // nsets * nobs running estimates
+    const double *h;        // per set rate difference (--sensitivity)
+    double kernel_time;     // accumulated kernel time [ns]
+    uint64_t rates_hash;    // identity of the rate table in checkpoints
+    cl_ulong traj_done;     // trajectories of the finished launches
+    double checkpoint_last; // wall time of the last checkpoint
+    ssa_store_t *store;     // columnar results (--store)
+    uint64_t store_rows;    // rows written to the store
+    struct ssa_tail tail;   // launch finished on host threads (--tail-offload)
+    int tail_pending;       // tail holds a launch not yet accumulated
+    cl_ulong tail_traj;     // trajectories finished on the host
+    cl_ulong tail_steps;    // their steps taken on the host
+    struct ssa_progress progress;
+};
+
+static double wall_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* trajectory run by item i of a launch (see ssa_kernel) */
+static cl_ulong launch_traj(const struct ssa_run *run, cl_ulong traj_base,
+                            cl_uint span, size_t i)
+{
+    return traj_base + (i / span) * run->opt->nrep + i % span;
+}
+
+/*
+ * Shards a launch across the parts: one contiguous range of items per
+ * part, cut at whole spans so that every share is a launch of its own
+ * and runs the same trajectories as in the unsharded launch.
+ */
+static void split_launch(struct ssa_run *run, cl_ulong traj_base, cl_uint span, cl_uint count)
+{
+    const size_t unit = (span == run->opt->nrep) ? 1 : span;
+    const size_t units = (count + unit - 1) / unit;
+
+    run->count = count;
+    for (int k=0; k<run->nparts; k++) {
+        struct ssa_part *p = &run->part[k];
+        size_t i0 = units * k / run->nparts * unit;
+        size_t i1 = units * (k + 1) / run->nparts * unit;
+
+        if (i0 > count) i0 = count;
+        if (i1 > count) i1 = count;
+        p->offset = (cl_uint) i0;
+        p->count = (cl_uint) (i1 - i0);
+        p->traj_base = launch_traj(run, traj_base, span, i0);
+        CL_CHECK(clSetKernelArg(p->kernel, 2, sizeof(cl_uint), (void*) &p->count));
+        CL_CHECK(clSetKernelArg(p->kernel, 4, sizeof(cl_ulong), (void*) &p->traj_base));
+        CL_CHECK(clSetKernelArg(p->kernel, 8, sizeof(cl_uint), (void*) &span));
+    }
+}
+
+/* per-item arrays of a launch, for transfer_items */
+enum {
+    ITEM_X = 1,
+    ITEM_FTIME = 2,
+    ITEM_COUNTERS = 4,
+    ITEM_DONE = 8,
+    ITEM_RNG = 16,
+    ITEM_SAMPLES = 32,
+    ITEM_Y = 64,
+    ITEM_ORDER = 128
+};
+
+static void transfer(const struct ssa_part *p, int write, cl_mem buf, size_t offset, size_t size, void *host)
+{
+    if (size == 0) return;
+    if (write)
+        CL_CHECK(clEnqueueWriteBuffer(p->queue, buf, CL_FALSE, offset, size, host, 0, NULL, NULL));
+    else
+        CL_CHECK(clEnqueueReadBuffer(p->queue, buf, CL_FALSE, offset, size, host, 0, NULL, NULL));
+}
+
+/*
+ * Copies the ITEM_* arrays in items of the launch in flight between the
+ * host arrays and the buffers of the parts, each part its share (write:
+ * to the parts), and waits until the copies are done.
+ */
+static void transfer_items(struct ssa_run *run, int write, int items)
+{
+    const size_t nsamples = run->opt->nsamples;
+
+    for (int k=0; k<run->nparts; k++) {
+        const struct ssa_part *p = &run->part[k];
+        const size_t o = p->offset, n = p->count;
+
+        if (items & ITEM_X)
+            transfer(p, write, p->x_d, 0, n*NX*sizeof(int), run->x_h + o*NX);
+        if (items & ITEM_FTIME)
+            transfer(p, write, p->ftime_d, 0, n*sizeof(float), run->ftime_h + o);
+        if (items & ITEM_COUNTERS)
+            transfer(p, write, p->counters_d, 0, n*sizeof(int), run->counters_h + o);
+        if (items & ITEM_DONE)
+            transfer(p, write, p->done_d, 0, n*sizeof(int), run->done_h + o);
+        if (items & ITEM_RNG)
+            transfer(p, write, p->rng_d, 0, n*SSA_RNG_STATE_WORDS*sizeof(uint32_t),
+                     run->rng_h + o*SSA_RNG_STATE_WORDS);
+        if (items & ITEM_Y)
+            transfer(p, write, p->y_d, 0, n*NX*sizeof(int), run->y_h + o*NX);
+        if (items & ITEM_ORDER)
+            transfer(p, write, p->order_d, 0, n*sizeof(cl_uint), run->order_h + o);
+        // species-major on both sides: one block per species
+        for (int j=0; j<NX && (items & ITEM_SAMPLES); j++)
+            transfer(p, write, p->samples_d, j*n*nsamples*sizeof(int), n*nsamples*sizeof(int),
+                     run->samples_h + (j*(size_t)run->count + o)*nsamples);
+    }
+    for (int k=0; k<run->nparts; k++)
+        CL_CHECK(clFinish(run->part[k].queue));
+}
+
+/*
+ * Writes the statistics of the finished launches and, if count > 0,
+ * the device state of the count items of the launch in flight.
+ */
+static void save_checkpoint(struct ssa_run *run, cl_uint count)
+{
+    const struct ssa_options *opt = run->opt;
+    struct ssa_checkpoint ck;
+
+    memset(&ck, 0, sizeof(ck));
+    ck.seed = opt->seed;
+    ck.nsets = run->nsets;
+    ck.nrep = opt->nrep;
+    ck.first = opt->first;
+    ck.ntraj = opt->ntraj;
+    ck.batch = opt->batch;
+    ck.rates_hash = run->rates_hash;
+    ck.nobs = run->nobs;
+    ck.traj_done = run->traj_done;
+    ck.kernel_time = run->kernel_time;
+    ck.stats = run->stats;
+    ck.count = count;
+    ck.nsamples = opt->nsamples;
+    if (count > 0) {
+        transfer_items(run, 0, ITEM_X | ITEM_FTIME | ITEM_COUNTERS | ITEM_DONE | ITEM_RNG
+                       | (opt->nsamples > 0 ? ITEM_SAMPLES : 0));
+        ck.x = (int32_t*) run->x_h;
+        ck.ftime = run->ftime_h;
+        ck.counters = (int32_t*) run->counters_h;
+        ck.done = (int32_t*) run->done_h;
+        ck.rng = run->rng_h;
+        if (opt->nsamples > 0)
+            ck.samples = (int32_t*) run->samples_h;
+    }
+    // the rows of the finished launches must be on disk before the checkpoint
+    if (run->store && ssa_store_flush(run->store, run->store_rows) != 0)
+        fprintf(stderr, "Warning: could not flush store %s\n", opt->store);
+    if (ssa_checkpoint_write(opt->checkpoint, &ck) != 0)
+        fprintf(stderr, "Warning: could not write checkpoint %s\n", opt->checkpoint);
+    run->checkpoint_last = wall_time();
+}
+
+static int checkpoint_due(const struct ssa_run *run)
+{
+    return run->opt->checkpoint
+        && wall_time() - run->checkpoint_last >= run->opt->checkpoint_interval;
+}
+
+/* adds the results of one launch to the statistics of their sets */
+static void accumulate(struct ssa_run *run, cl_ulong traj_base, cl_uint span, cl_uint count)
+{
+    const struct ssa_options *opt = run->opt;
+
+    for (size_t i=0; i<count; i++) {
+        cl_ulong t = launch_traj(run, traj_base, span, i);
+        ssa_stats_t *st = run->stats + (t / opt->nrep) * run->nobs;
+        const int *xt = run->x_h + i*NX;
+
+        if (opt->sens) {
+            const int *yt = run->y_h + i*NX;
+            for (int j=0; j<NX; j++)
+                ssa_stats_add(&st[j], (yt[j] - xt[j]) / run->h[t / opt->nrep]);
+        } else {
+            for (int j=0; j<NX; j++) ssa_stats_add(&st[j], xt[j]);
+            ssa_stats_add(&st[NX], run->counters_h[i]);
+        }
+
+        if (opt->print) {
+            // trajectory index (parameter set/replicate), final state, steps, final time
+            printf("%llu (%llu/%llu): ", (unsigned long long)t,
+                   (unsigned long long)(t / opt->nrep), (unsigned long long)(t % opt->nrep));
+            for (int j=0; j<NX; j++) printf("%d ", xt[j]);
+            if (opt->sens) {
+                printf("| ");
+                for (int j=0; j<NX; j++) printf("%d ", run->y_h[i*NX+j]);
+            }
+            printf(", %d, ", run->counters_h[i]);
+            printf("%f\n", run->ftime_h[i]);
+        }
+    }
+}
+
+/*
+ * Writes the results of one launch as the next count rows of the store,
+ * one write per column (and one append of the packed time series).
+ */
+static void store_launch(struct ssa_run *run, cl_ulong traj_base, cl_uint span, cl_uint count)
+{
+    const struct ssa_options *opt = run->opt;
+    ssa_store_t *st = run->store;
+    const uint64_t row = run->store_rows;
+    uint64_t *traj = (uint64_t*) malloc(count*sizeof(uint64_t));
+    int col = 0, ok;
+
+    for (size_t i=0; i<count; i++) traj[i] = launch_traj(run, traj_base, span, i);
+    ok = ssa_store_write(st, col++, row, traj, count) == 0;
+    free(traj);
+
+    for (int j=0; j<NX; j++) {
+        for (size_t i=0; i<count; i++) run->column_h[i] = run->x_h[i*NX+j];
+        ok = ok && ssa_store_write(st, col++, row, run->column_h, count) == 0;
+    }
+    if (opt->sens) {
+        for (int j=0; j<NX; j++) {
+            for (size_t i=0; i<count; i++) run->column_h[i] = run->y_h[i*NX+j];
+            ok = ok && ssa_store_write(st, col++, row, run->column_h, count) == 0;
+        }
+    }
+    ok = ok && ssa_store_write(st, col++, row, run->counters_h, count) == 0;
+    ok = ok && ssa_store_write(st, col++, row, run->ftime_h, count) == 0;
+    if (opt->pack) {
+        struct ssa_store_packed *pk = (struct ssa_store_packed*) malloc(count*sizeof(*pk));
+        uint64_t blob = 0;
+
+        ok = ok && ssa_store_append(st, run->packed_h, run->packed_words, &blob) == 0;
+        for (int j=0; j<NX; j++) {
+            for (size_t i=0; i<count; i++) {
+                size_t r = (size_t)j*count + i;
+                pk[i].offset = blob + run->offsets_h[r];
+                pk[i].base = run->base_h[r];
+                pk[i].bits = run->bits_h[r];
+            }
+            ok = ok && ssa_store_write(st, col++, row, pk, count) == 0;
+        }
+        free(pk);
+    } else {
+        for (int j=0; j<NX && opt->nsamples > 0; j++)
+            ok = ok && ssa_store_write(st, col++, row,
+                    run->samples_h + (size_t)j*count*opt->nsamples, count) == 0;
+    }
+
+    if (!ok) {
+        printf("Error: Failed to write store %s!\n", opt->store);
+        exit(1);
+    }
+    run->store_rows += count;
+}
+
+/* launch item and its expected number of steps */
+struct launch_item_cost {
+    float cost;
+    cl_uint item;
+};
+
+/* most expensive first; equal costs keep launch order */
+static int cmp_item_cost(const void *a, const void *b)
+{
+    const struct launch_item_cost *p = (const struct launch_item_cost*) a;
+    const struct launch_item_cost *q = (const struct launch_item_cost*) b;
+
+    if (p->cost != q->cost) return p->cost < q->cost ? 1 : -1;
+    return p->item < q->item ? -1 : p->item > q->item;
+}
+
+/*
+ * Expected reactions of a trajectory of rate constants k: about
+ * a0 * FINALTIME, a0 the total propensity at the initial state.
+ */
+static float expected_steps(const float *k)
+{
+    return (x[0]*k[0] + x[1]*k[1] + x[1]*k[2]) * (float) FINALTIME;
+}
+
+/*
+ * Sorts the items of a launch by expected cost (expected_steps) into
+ * order, so the work items of a work group finish at about the same
+ * step.
+ */
+static void order_by_cost(struct ssa_run *run, cl_ulong traj_base, cl_uint span, cl_uint count,
+                          cl_uint *order)
+{
+    for (cl_uint i=0; i<count; i++) {
+        const float *k = run->rates + (launch_traj(run, traj_base, span, i) / run->opt->nrep)*NCHANNEL;
+        run->cost_h[i].cost = expected_steps(k);
+        run->cost_h[i].item = i;
+    }
+    qsort(run->cost_h, count, sizeof(*run->cost_h), cmp_item_cost);
+    for (cl_uint i=0; i<count; i++) order[i] = run->cost_h[i].item;
+}
+
+/* runs one kernel launch (or slice) on queue and adds its time to kernel_time */
+static void enqueue_kernel(struct ssa_run *run, cl_command_queue queue, cl_kernel kernel,
+                           size_t globalsize, size_t localsize)
+{
+    /* Enqueue kernel with profiling event   */
+    cl_event kernel_completion;
+    cl_ulong time_start, time_end;
+
+    CL_CHECK(clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &globalsize, &localsize, 0, NULL, &kernel_completion));
+    clFinish(queue);
+
+    CL_CHECK(clWaitForEvents(1, &kernel_completion));
+
+    CL_CHECK(clGetEventProfilingInfo(kernel_completion, CL_PROFILING_COMMAND_START,
+               sizeof(time_start), &time_start, NULL));
+    CL_CHECK(clGetEventProfilingInfo(kernel_completion, CL_PROFILING_COMMAND_END,
+               sizeof(time_end), &time_end, NULL));
+    CL_CHECK(clReleaseEvent(kernel_completion));
+
+    run->kernel_time += time_end - time_start;
+}
+
+/*
+ * Runs one launch (or slice) of the trajectory kernel on all parts at
+ * once. The parts run concurrently, so the longest adds to kernel_time.
+ */
+static void enqueue_parts(struct ssa_run *run)
+{
+    const struct ssa_options *opt = run->opt;
+    size_t localsize = XBLOCKSIZE;
+    // Number of total work items - localSize must be devisor; a work item
+    // of ssa_kernel runs items_per_wi launch items, ssa_sg_kernel takes
+    // SSA_SG_WIDTH work items per launch item
+    size_t per_wi = (opt->sens || opt->kernel == KERNEL_SUBGROUP) ? 1 : opt->items_per_wi;
+    size_t width = (opt->kernel == KERNEL_SUBGROUP) ? SSA_SG_WIDTH : 1;
+    cl_ulong longest = 0;
+
+    for (int k=0; k<run->nparts; k++) {
+        struct ssa_part *p = &run->part[k];
+        size_t globalsize = (p->count*width + localsize*per_wi - 1) / (localsize*per_wi) * localsize;
+
+        if (p->count == 0) continue;
+        CL_CHECK(clEnqueueNDRangeKernel(p->queue, p->kernel, 1, NULL, &globalsize, &localsize,
+                    0, NULL, &p->event));
+        CL_CHECK(clFlush(p->queue));
+    }
+    for (int k=0; k<run->nparts; k++) {
+        struct ssa_part *p = &run->part[k];
+        cl_ulong time_start, time_end;
+
+        if (p->count == 0) continue;
+        CL_CHECK(clWaitForEvents(1, &p->event));
+        CL_CHECK(clGetEventProfilingInfo(p->event, CL_PROFILING_COMMAND_START,
+                   sizeof(time_start), &time_start, NULL));
+        CL_CHECK(clGetEventProfilingInfo(p->event, CL_PROFILING_COMMAND_END,
+                   sizeof(time_end), &time_end, NULL));
+        CL_CHECK(clReleaseEvent(p->event));
+        if (time_end - time_start > longest) longest = time_end - time_start;
+    }
+    run->kernel_time += longest;
+}
+
+/*
+ * Sums the progress counters of the parts, mapped through their own
+ * queues or, from the progress thread while kernels run, through the
+ * monitor queues.
+ */
+static void read_progress(struct ssa_run *run, int monitor, cl_ulong *finished, cl_ulong *steps,
+                          float *tmax)
+{
+    *finished = 0;
+    *steps = 0;
+    *tmax = 0.0f;
+    for (int k=0; k<run->nparts; k++) {
+        const struct ssa_part *p = &run->part[k];
+        cl_command_queue queue = monitor ? p->monitor_queue : p->queue;
+        cl_int err;
+        cl_uint *w = (cl_uint*) clEnqueueMapBuffer(queue, p->progress_d, CL_TRUE, CL_MAP_READ, 0,
+                SSA_PROGRESS_WORDS*sizeof(cl_uint), 0, NULL, NULL, &err);
+        float t;
+
+        CL_CHECK(err);
+        *finished += w[SSA_PROGRESS_FINISHED];
+        *steps += ((cl_ulong) w[SSA_PROGRESS_STEPS_HI] << 32) + w[SSA_PROGRESS_STEPS_LO];
+        memcpy(&t, &w[SSA_PROGRESS_TIME], sizeof(t));
+        if (t > *tmax) *tmax = t;
+        CL_CHECK(clEnqueueUnmapMemObject(queue, p->progress_d, w, 0, NULL, NULL));
+    }
+}
+
+/* notes the start of a launch for the progress reports */
+static void progress_launch(struct ssa_run *run)
+{
+    const cl_uint zero = 0;
+    cl_ulong finished, steps;
+    float tmax;
+
+    read_progress(run, 0, &finished, &steps, &tmax);
+    for (int k=0; k<run->nparts; k++)
+        CL_CHECK(clEnqueueFillBuffer(run->part[k].queue, run->part[k].progress_d, &zero, sizeof(zero),
+                    SSA_PROGRESS_TIME*sizeof(cl_uint), sizeof(cl_uint), 0, NULL, NULL));
+    pthread_mutex_lock(&run->progress.lock);
+    run->progress.launch0 = finished;
+    run->progress.done0 = finished + __atomic_load_n(&run->tail.finished, __ATOMIC_RELAXED);
+    run->progress.steps0 = steps + __atomic_load_n(&run->tail.finished_steps, __ATOMIC_RELAXED);
+    run->progress.count = run->count;
+    pthread_mutex_unlock(&run->progress.lock);
+}
+
+/*
+ * Reports the progress of the run every progress_interval seconds and
+ * once more when stopped. Once a launch has finished, the fraction done
+ * is the steps taken over the steps expected at the rate per trajectory
+ * of the finished launches; during the first launch it counts the
+ * unfinished trajectories at the largest simulated time of the launch.
+ * Trajectories and steps finished by tail threads (--tail-offload) count
+ * as the device's do. The ETA extrapolates the wall time of this
+ * process.
+ */
+static void *progress_thread(void *arg)
+{
+    struct ssa_run *run = (struct ssa_run*) arg;
+    struct ssa_progress *pg = &run->progress;
+    const double interval = run->opt->progress_interval;
+    const cl_ulong todo = pg->total - pg->resumed;
+    cl_ulong last_steps = 0;
+    double last = pg->start;
+    int stop = 0;
+
+    while (!stop) {
+        struct timespec until;
+        cl_ulong finished, steps, launch0, done0, steps0, done, running, all_steps;
+        cl_uint count;
+        float tmax;
+        double now, frac;
+
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += (time_t) interval;
+        until.tv_nsec += (long) ((interval - (time_t) interval) * 1e9);
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&pg->lock);
+        while (!pg->stop && pthread_cond_timedwait(&pg->wake, &pg->lock, &until) != ETIMEDOUT)
+            ;
+        stop = pg->stop;
+        launch0 = pg->launch0;
+        done0 = pg->done0;
+        steps0 = pg->steps0;
+        count = pg->count;
+        pthread_mutex_unlock(&pg->lock);
+
+        read_progress(run, 1, &finished, &steps, &tmax);
+        now = wall_time();
+        done = finished + __atomic_load_n(&run->tail.finished, __ATOMIC_RELAXED);
+        all_steps = steps + __atomic_load_n(&run->tail.finished_steps, __ATOMIC_RELAXED);
+        running = (finished - launch0 < count) ? count - (finished - launch0) : 0;
+        if (done >= todo)
+            frac = 1.0;
+        else if (done0 > 0)
+            frac = all_steps / ((double) steps0 / done0 * todo);
+        else
+            frac = (done + running * (tmax / FINALTIME)) / todo;
+        if (frac > 1.0) frac = 1.0;
+
+        fprintf(stderr, "progress: %llu/%llu trajectories (%.1f%%), %llu reactions, %.3g reactions/s, t_max %g, ",
+                (unsigned long long)(pg->resumed + done), (unsigned long long)pg->total,
+                100.0 * (pg->resumed + done) / (pg->total > 0 ? pg->total : 1),
+                (unsigned long long)all_steps, (all_steps - last_steps) / (now - last > 0.0 ? now - last : 1.0), tmax);
+        if (frac > 0.0)
+            fprintf(stderr, "ETA %.0f s\n", (now - pg->start) * (1.0 - frac) / frac);
+        else
+            fprintf(stderr, "ETA unknown\n");
+        last_steps = all_steps;
+        last = now;
+    }
+    return NULL;
+}
+
+/*
+ * Compresses the time series of a launch on the device (one part only):
+ * pass 1 gives
+ * the bits and base of every row, the host turns the bits into word
+ * offsets and pass 2 packs the rows back to back, so only packed_words
+ * words are read back.
+ */
+static void pack_samples(struct ssa_run *run, cl_uint count)
+{
+    const cl_command_queue queue = run->part[0].queue;
+    const cl_uint nsamples = run->opt->nsamples;
+    cl_uint nrows = NX*count;
+    size_t localsize = XBLOCKSIZE;
+    size_t globalsize = (nrows + localsize - 1) / localsize * localsize;
+    cl_uint total = 0;
+
+    CL_CHECK(clSetKernelArg(run->pack_bits_kernel, 1, sizeof(cl_uint), (void*) &nrows));
+    enqueue_kernel(run, queue, run->pack_bits_kernel, globalsize, localsize);
+    CL_CHECK(clEnqueueReadBuffer(queue, run->bits_d, CL_FALSE, 0, nrows*sizeof(cl_uint), run->bits_h, 0, NULL, NULL));
+    CL_CHECK(clEnqueueReadBuffer(queue, run->base_d, CL_TRUE, 0, nrows*sizeof(int), run->base_h, 0, NULL, NULL));
+
+    for (size_t r=0; r<nrows; r++) {
+        run->offsets_h[r] = total;
+        total += (cl_uint) ssa_pack_words(nsamples, run->bits_h[r]);
+    }
+    CL_CHECK(clEnqueueWriteBuffer(queue, run->offsets_d, CL_TRUE, 0, nrows*sizeof(cl_uint), run->offsets_h, 0, NULL, NULL));
+
+    CL_CHECK(clSetKernelArg(run->pack_kernel, 1, sizeof(cl_uint), (void*) &nrows));
+    enqueue_kernel(run, queue, run->pack_kernel, globalsize, localsize);
+    if (total > 0)
+        CL_CHECK(clEnqueueReadBuffer(queue, run->packed_d, CL_TRUE, 0, total*sizeof(cl_uint), run->packed_h, 0, NULL, NULL));
+    run->packed_words = total;
+}
+
+/* exchanges the per-item host arrays of the run with those of the tail */
+static void swap_tail_arrays(struct ssa_run *run)
+{
+    int *x = run->x_h, *counters = run->counters_h, *done = run->done_h, *samples = run->samples_h;
+    float *ftime = run->ftime_h;
+    uint32_t *rng = run->rng_h;
+
+    run->x_h = run->tail.x;                 run->tail.x = x;
+    run->ftime_h = run->tail.ftime;         run->tail.ftime = ftime;
+    run->counters_h = run->tail.counters;   run->tail.counters = counters;
+    run->done_h = run->tail.done;           run->tail.done = done;
+    run->rng_h = run->tail.rng;             run->tail.rng = rng;
+    run->samples_h = run->tail.samples;     run->tail.samples = samples;
+}
+
+/* codes the time series of a launch on the host, as pack_samples does on the device */
+static void pack_samples_host(struct ssa_run *run, cl_uint count)
+{
+    const cl_uint nsamples = run->opt->nsamples;
+    cl_uint total = 0;
+
+    for (size_t r=0; r<(size_t)NX*count; r++) {
+        const int *row = run->samples_h + r*nsamples;
+        run->bits_h[r] = ssa_pack_bits(row, nsamples);
+        run->base_h[r] = row[0];
+        run->offsets_h[r] = total;
+        total += (cl_uint) ssa_pack_words(nsamples, run->bits_h[r]);
+        ssa_pack_row(row, nsamples, run->bits_h[r], run->packed_h + run->offsets_h[r]);
+    }
+    run->packed_words = total;
+}
+
+/*
+ * Waits for the launch finishing on host threads, if any, and adds its
+ * results to the statistics and the store, in launch order: it is
+ * called before the results of the next launch are read.
+ */
+static void finish_tail(struct ssa_run *run)
+{
+    struct ssa_tail *t = &run->tail;
+
+    if (!run->tail_pending) return;
+    ssa_tail_wait(t);
+    run->tail_steps += t->steps;
+    run->tail_pending = 0;
+
+    swap_tail_arrays(run);
+    if (run->opt->pack) pack_samples_host(run, t->count);
+    accumulate(run, t->traj_base, t->span, t->count);
+    if (run->store) store_launch(run, t->traj_base, t->span, t->count);
+    swap_tail_arrays(run);
+}
+
+/*
+ * Hands the launch in flight, stopped between slices with active items
+ * still running, to host threads (--tail-offload). Its state is read
+ * back into the run's arrays, which the tail takes over in exchange for
+ * its spare ones, so the next launch can start on the device at once.
+ */
+static void offload_tail(struct ssa_run *run, cl_ulong traj_base, cl_uint span, cl_uint count,
+                         size_t active)
+{
+    const struct ssa_options *opt = run->opt;
+    struct ssa_tail *t = &run->tail;
+
+    finish_tail(run);
+
+    transfer_items(run, 0, ITEM_X | ITEM_FTIME | ITEM_COUNTERS | ITEM_RNG
+                   | (opt->nsamples > 0 ? ITEM_SAMPLES : 0));
+
+    if (!t->x) {
+        // spare arrays, allocated at the first offload
+        t->x = (int32_t*) malloc(opt->batch*NX*sizeof(int));
+        t->ftime = (float*) malloc(opt->batch*sizeof(float));
+        t->counters = (int32_t*) malloc(opt->batch*sizeof(int));
+        t->done = (int32_t*) malloc(opt->batch*sizeof(int));
+        t->rng = (uint32_t*) malloc(opt->batch*SSA_RNG_STATE_WORDS*sizeof(uint32_t));
+        if (opt->nsamples > 0)
+            t->samples = (int32_t*) malloc(NX*opt->batch*opt->nsamples*sizeof(int));
+    }
+    swap_tail_arrays(run);
+
+    t->rates = run->rates;
+    t->nrep = opt->nrep;
+    t->traj_base = traj_base;
+    t->span = span;
+    t->count = count;
+    t->nsamples = opt->nsamples;
+    if (ssa_tail_start(t, opt->tail_threads) != 0) {
+        printf("Error: Failed to start the tail threads!\n");
+        exit(1);
+    }
+    run->tail_pending = 1;
+    run->tail_traj += active;
+}
+
+/*
+ * Runs count trajectories in one launch: span consecutive replicates of
+ * consecutive parameter sets, starting at trajectory traj_base. With
+ * span == nrep the launch is the contiguous range traj_base..+count-1.
+ * With --max-steps the launch is run in slices until every item is
+ * done, checkpointing in between when one is due. resume continues
+ * items whose state was loaded into the host arrays from a checkpoint.
+ * The launch is sharded across the parts, which run it concurrently.
+ */
+static void run_launch(struct ssa_run *run, cl_ulong traj_base, cl_uint span, cl_uint count,
+                       int resume)
+{
+    const struct ssa_options *opt = run->opt;
+
+    split_launch(run, traj_base, span, count);
+    if (opt->progress_interval > 0.0) progress_launch(run);
+    if (resume) {
+        transfer_items(run, 1, ITEM_X | ITEM_FTIME | ITEM_COUNTERS | ITEM_DONE | ITEM_RNG
+                       | (opt->nsamples > 0 ? ITEM_SAMPLES : 0));
+    } else {
+        init_x_array(run->x_h, count);
+#if SSA_RNG == SSA_RNG_TINYMT && SSA_TINYMT_PRECOMPUTED
+        // start states of the launch; contiguous launches are cached with --state-cache
+        for (size_t i=0; i<count; i += (span == opt->nrep) ? count : span) {
+            size_t n = (span == opt->nrep) ? count : (count - i < span ? count - i : span);
+            uint32_t *states = tinymt32j_states_get(opt->seed, launch_traj(run, traj_base, span, i), n,
+                    0, (span == opt->nrep) ? opt->state_cache : NULL);
+            if (!states)
+            {
+                printf("Error: Failed to get TinyMT start states!\n");
+                exit(1);
+            }
+            memcpy(run->rng_h + i*SSA_RNG_STATE_WORDS, states,
+                   n*TINYMT32J_STATE_WORDS*sizeof(uint32_t));
+            free(states);
+        }
+#elif SSA_RNG == SSA_RNG_TINYMT_WP
+        // parameter set of every trajectory, seeded on the device
+        for (size_t i=0; i<count; i++) {
+            uint32_t *st = run->rng_h + i*SSA_RNG_STATE_WORDS;
+            memset(st, 0, (SSA_RNG_STATE_WORDS - TINYMT32WP_PARAM_WORDS)*sizeof(uint32_t));
+            memcpy(st + SSA_RNG_STATE_WORDS - TINYMT32WP_PARAM_WORDS,
+                   run->tinymt_params + launch_traj(run, traj_base, span, i)*TINYMT32WP_PARAM_WORDS,
+                   TINYMT32WP_PARAM_WORDS*sizeof(uint32_t));
+        }
+#endif
+        transfer_items(run, 1, ITEM_X | (SSA_RNG_HOST_STATES ? ITEM_RNG : 0));
+    }
+
+    if (opt->sens) {
+        enqueue_parts(run);
+    } else {
+        cl_int start = !resume;
+
+        if (opt->cost_order) {
+            // each part orders its own share
+            for (int k=0; k<run->nparts; k++) {
+                struct ssa_part *p = &run->part[k];
+                order_by_cost(run, p->traj_base, span, p->count, run->order_h + p->offset);
+            }
+            transfer_items(run, 1, ITEM_ORDER);
+        }
+
+        for (int k=0; k<run->nparts; k++)
+            CL_CHECK(clSetKernelArg(run->part[k].kernel, 11, sizeof(cl_uint), (void*) &opt->max_steps));
+        while (1) {
+            size_t active = 0;
+
+            for (int k=0; k<run->nparts; k++)
+                CL_CHECK(clSetKernelArg(run->part[k].kernel, 12, sizeof(cl_int), (void*) &start));
+            enqueue_parts(run);
+            if (opt->max_steps == 0) break;
+
+            transfer_items(run, 0, ITEM_DONE);
+            for (size_t i=0; i<count; i++) active += !run->done_h[i];
+            if (active == 0) break;
+            if (active <= opt->tail_fraction * count) {
+                offload_tail(run, traj_base, span, count, active);
+                return;
+            }
+
+            start = 0;
+            if (checkpoint_due(run)) save_checkpoint(run, count);
+        }
+    }
+
+    // the launch before, finished on the host meanwhile, comes first
+    finish_tail(run);
+
+    /* Read the kernel's output    */
+    // with several parts the time series are read and packed on the host
+    int device_pack = opt->pack && run->nparts == 1;
+    transfer_items(run, 0, ITEM_X | ITEM_FTIME | ITEM_COUNTERS | (opt->sens ? ITEM_Y : 0)
+                   | (opt->nsamples > 0 && !device_pack ? ITEM_SAMPLES : 0));
+    if (device_pack)
+        pack_samples(run, count);
+    else if (opt->pack)
+        pack_samples_host(run, count);
+
+    accumulate(run, traj_base, span, count);
+    if (run->store) store_launch(run, traj_base, span, count);
+}
+
+/* widest confidence interval over the selected outputs of all sets */
+static double worst_ci(const struct ssa_run *run, size_t *set, int *obs)
+{
+    double worst = 0.0;
+
+    for (size_t s=0; s<run->nsets; s++) {
+        for (int j=0; j<NX; j++) {
+            if (!run->opt->output[j]) continue;
+            double ci = ssa_stats_ci(&run->stats[s*run->nobs+j], CI_Z);
+            if (!(ci <= worst)) {   // also takes an infinite interval
+                worst = ci;
+                *set = s;
+                *obs = j;
+            }
+        }
+    }
+    return worst;
+}
+
+/*
+ * Adaptive ensemble: rounds of round_reps replicates of every set, each
+ * split into launches of at most opt->batch trajectories, until every
+ * selected output has a confidence interval no wider than ci_target,
+ * the time budget would be exceeded by another round or all nrep
+ * replicates have run. Prints the estimates after every round.
+ */
+static void run_adaptive(struct ssa_run *run)
+{
+    const struct ssa_options *opt = run->opt;
+    const size_t m = opt->round_reps;
+    const size_t sets_per = (m >= opt->batch) ? 1 : opt->batch / m;
+    const size_t reps_per = (m >= opt->batch) ? opt->batch : m;
+    const double start = wall_time();
+    double round_time = 0.0;
+    const char *reason = "all trajectories done";
+
+    for (size_t r0 = 0, round = 1; r0 < opt->nrep; r0 += m, round++) {
+        const size_t r1 = (r0 + m < opt->nrep) ? r0 + m : opt->nrep;
+        const double round_start = wall_time();
+        size_t set = 0;
+        int obs = 0;
+
+        for (size_t s0 = 0; s0 < run->nsets; s0 += sets_per) {
+            size_t ns = (run->nsets - s0 < sets_per) ? run->nsets - s0 : sets_per;
+            for (size_t r = r0; r < r1; r += reps_per) {
+                size_t nr = (r1 - r < reps_per) ? r1 - r : reps_per;
+                run_launch(run, s0 * opt->nrep + r, (cl_uint) nr, (cl_uint) (ns * nr), 0);
+            }
+        }
+        finish_tail(run);
+        round_time = wall_time() - round_start;
+
+        double ci = worst_ci(run, &set, &obs);
+        printf("round %zu: n=%zu per set, widest ci %g (set %zu, %s%d), %.2f s\n",
+               round, r1, ci, set, opt->sens ? "dx" : "x", obs, wall_time() - start);
+        if (run->nsets == 1) {
+            for (int j=0; j<NX; j++) {
+                if (!opt->output[j]) continue;
+                printf("    %s%d = %g +- %g\n", opt->sens ? "dx" : "x", j,
+                       run->stats[j].mean, ssa_stats_ci(&run->stats[j], CI_Z));
+            }
+        }
+        fflush(stdout);
+
+        if (opt->ci_target > 0.0 && ci <= opt->ci_target) {
+            reason = "confidence target reached";
+            break;
+        }
+        if (opt->time_budget > 0.0 && wall_time() - start + round_time > opt->time_budget) {
+            reason = "time budget exhausted";
+            break;
+        }
+    }
+    printf("stopped: %s\n", reason);
+}
+
+/*
+ * Per row of the coupled finite difference table: the estimate of
+ * d E[x_j] / d k = E[Y_j - X_j] / h, with h the actual (rounded)
+ * difference of the perturbed and nominal rate, its confidence interval
+ * and the standard deviation of the per trajectory differences.
+ */
+static void print_cfd_summary(const struct ssa_run *run, const float *table,
+                              const int *channels, int nsens)
+{
+    for (size_t row = 0; row < run->nsets; row++) {
+        const ssa_stats_t *d = run->stats + row * run->nobs;
+        const float *k = table + row * 2 * NCHANNEL;
+        int ch = channels[row % nsens];
+
+        if (d[0].n == 0) continue;
+        printf("set %zu: d/dk%d at rates", row / nsens, ch);
+        for (int c=0; c<NCHANNEL; c++) printf(" %g", k[c]);
+        printf(" (h=%g), n=%zu\n", run->h[row], d[0].n);
+        for (int j=0; j<NX; j++) {
+            if (!run->opt->output[j]) continue;
+            printf("    dx%d/dk%d = %g +- %g (sd %g)\n", j, ch, d[j].mean,
+                   ssa_stats_ci(&d[j], CI_Z), ssa_stats_sd(&d[j]));
+        }
+    }
+}
+
+/* per parameter set mean and standard deviation of the final state */
+static void print_set_summary(const struct ssa_run *run, const float *rates)
+{
+    for (size_t set = 0; set < run->nsets; set++) {
+        const ssa_stats_t *xs = run->stats + set * run->nobs;
+
+        if (xs[0].n == 0) continue;
+        printf("set %zu: rates", set);
+        for (int c=0; c<NCHANNEL; c++) printf(" %g", rates[set*NCHANNEL+c]);
+        printf(", n=%zu, x mean/sd", xs[0].n);
+        for (int j=0; j<NX; j++)
+            printf(" %.3f/%.3f", xs[j].mean, ssa_stats_sd(&xs[j]));
+        printf(", steps %.1f\n", xs[NX].mean);
+    }
+}
+
+/*
+ * Partitions dev into one sub-device per NUMA node (--numa). Returns
+ * the number of sub-devices, or 0 if the device cannot be partitioned
+ * by NUMA node or has only one.
+ */
+static cl_uint numa_sub_devices(cl_device_id dev, cl_device_id **subs)
+{
+    const cl_device_partition_property props[] = {
+        CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, CL_DEVICE_AFFINITY_DOMAIN_NUMA, 0
+    };
+    cl_device_affinity_domain domains = 0;
+    cl_uint n = 0;
+
+    if (clGetDeviceInfo(dev, CL_DEVICE_PARTITION_AFFINITY_DOMAIN, sizeof(domains), &domains, NULL) != CL_SUCCESS
+        || !(domains & CL_DEVICE_AFFINITY_DOMAIN_NUMA))
+        return 0;
+    if (clCreateSubDevices(dev, props, 0, NULL, &n) != CL_SUCCESS || n < 2)
+        return 0;
+    *subs = (cl_device_id*) malloc(n*sizeof(cl_device_id));
+    CL_CHECK(clCreateSubDevices(dev, props, n, *subs, NULL));
+    return n;
+}
+
+/*
+ * A buffer first written through the part's queue: CPU runtimes place
+ * pages where they are first touched, so this puts the buffer on the
+ * part's NUMA node.
+ */
+static cl_mem part_buffer(cl_context context, const struct ssa_part *p, cl_mem_flags flags,
+                          size_t size, const char *name)
+{
+    const cl_int zero = 0;
+    cl_mem buf = clCreateBuffer(context, flags, size, NULL, NULL);
+
+    if (!buf)
+    {
+        printf("Error: Failed to allocate device memory (%s)!\n", name);
+        exit(1);
+    }
+    CL_CHECK(clEnqueueFillBuffer(p->queue, buf, &zero, sizeof(zero), 0, size, 0, NULL, NULL));
+    return buf;
+}
+
+/*
+ * Allocates the host arrays and the device buffers of the parts for
+ * launches of opt->batch trajectories and binds them to the kernels.
+ * The device buffers of a part hold its share of a launch: a launch is
+ * split at whole spans, of at most round_reps trajectories in adaptive
+ * runs and one otherwise.
+ */
+static void create_buffers(struct ssa_run *run, cl_context context, cl_program program, cl_mem rates_d)
+{
+    const struct ssa_options *opt = run->opt;
+    cl_uint nrep = (cl_uint) opt->nrep;
+    cl_int err;
+
+    size_t max_span = opt->adaptive ? (opt->round_reps < opt->batch ? opt->round_reps : opt->batch) : 1;
+    size_t part_batch = (opt->batch + run->nparts - 1) / run->nparts + 2*max_span;
+    if (run->nparts == 1 || part_batch > opt->batch) part_batch = opt->batch;
+
+    run->x_h = (int*) malloc(opt->batch*NX*sizeof(int));
+    run->ftime_h = (float*) malloc(opt->batch*sizeof(float));
+    run->counters_h = (int*) malloc(opt->batch*sizeof(int));
+    run->done_h = (int*) malloc(opt->batch*sizeof(int));
+    run->rng_h = (uint32_t*) malloc(opt->batch*SSA_RNG_STATE_WORDS*sizeof(uint32_t));
+
+    // launch item of every work item: launch order unless --cost-order sorts it
+    run->order_h = (cl_uint*) malloc(opt->batch*sizeof(cl_uint));
+    for (size_t i=0; i<opt->batch; i++) run->order_h[i] = (cl_uint) i;
+    if (opt->cost_order)
+        run->cost_h = (struct launch_item_cost*) malloc(opt->batch*sizeof(*run->cost_h));
+
+    // time series of the launch in flight
+    if (opt->nsamples > 0)
+        run->samples_h = (int*) malloc(NX*opt->batch*opt->nsamples*sizeof(int));
+
+    for (int k=0; k<run->nparts; k++)
+    {
+        struct ssa_part *p = &run->part[k];
+
+        p->x_d = part_buffer(context, p, CL_MEM_READ_WRITE, sizeof(int)*NX*part_batch, "x_array_d");
+        p->ftime_d = part_buffer(context, p, CL_MEM_WRITE_ONLY, sizeof(float)*part_batch, "finalT_array_d");
+        p->counters_d = part_buffer(context, p, CL_MEM_READ_WRITE, sizeof(int)*part_batch, "counter_array_d");
+        p->done_d = part_buffer(context, p, CL_MEM_READ_WRITE, sizeof(int)*part_batch, "done_d");
+        // per-item generator state, kept between launch slices
+        p->rng_d = part_buffer(context, p, CL_MEM_READ_WRITE,
+                sizeof(uint32_t)*SSA_RNG_STATE_WORDS*part_batch, "rng_d");
+        p->order_d = part_buffer(context, p, CL_MEM_READ_ONLY, sizeof(cl_uint)*part_batch, "order_d");
+        CL_CHECK(clEnqueueWriteBuffer(p->queue, p->order_d, CL_TRUE, 0, sizeof(cl_uint)*part_batch,
+                    run->order_h, 0, NULL, NULL));
+        // a dummy buffer without --samples
+        p->samples_d = part_buffer(context, p, CL_MEM_READ_WRITE,
+                sizeof(int)*(opt->nsamples > 0 ? NX*part_batch*opt->nsamples : 1), "samples_d");
+        // final state of the perturbed process of the coupled pairs
+        if (opt->sens)
+            p->y_d = part_buffer(context, p, CL_MEM_WRITE_ONLY, sizeof(int)*NX*part_batch, "y_array_d");
+        // read by the host while the kernel runs: host memory where the device can use it
+        p->progress_d = part_buffer(context, p, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
+                sizeof(cl_uint)*SSA_PROGRESS_WORDS, "progress_d");
+    }
+    if (opt->sens)
+        run->y_h = (int*) malloc(opt->batch*NX*sizeof(int));
+
+    // compressed time series: bits, base and word offset per row, packed
+    // words; packed on the device with one part, on the host otherwise
+    if (opt->pack)
+    {
+        if ((cl_ulong) NX*opt->batch*opt->nsamples > UINT32_MAX)
+        {
+            printf("Error: --pack needs NX * batch * samples below 2^32!\n");
+            exit(1);
+        }
+        run->bits_h = (cl_uint*) malloc(NX*opt->batch*sizeof(cl_uint));
+        run->base_h = (int*) malloc(NX*opt->batch*sizeof(int));
+        run->offsets_h = (cl_uint*) malloc(NX*opt->batch*sizeof(cl_uint));
+        run->packed_h = (cl_uint*) malloc(NX*opt->batch*opt->nsamples*sizeof(cl_uint));
+    }
+    if (opt->pack && run->nparts == 1)
+    {
+        run->pack_bits_kernel = clCreateKernel(program, KERNEL_PACK_BITS_FUNC, &err);
+        if (!run->pack_bits_kernel || err != CL_SUCCESS)
+        {
+            printf("Error: Failed to create compute kernel (%s)!\n", KERNEL_PACK_BITS_FUNC);
+            exit(1);
+        }
+        run->pack_kernel = clCreateKernel(program, KERNEL_PACK_FUNC, &err);
+        if (!run->pack_kernel || err != CL_SUCCESS)
+        {
+            printf("Error: Failed to create compute kernel (%s)!\n", KERNEL_PACK_FUNC);
+            exit(1);
+        }
+        run->bits_d = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint)*NX*opt->batch, NULL, NULL);
+        run->base_d = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(int)*NX*opt->batch, NULL, NULL);
+        run->offsets_d = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(cl_uint)*NX*opt->batch, NULL, NULL);
+        run->packed_d = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                sizeof(cl_uint)*NX*opt->batch*opt->nsamples, NULL, NULL);
+        if (!run->bits_d || !run->base_d || !run->offsets_d || !run->packed_d)
+        {
+            printf("Error: Failed to allocate device memory (packed time series)!\n");
+            exit(1);
+        }
+
+        err  = clSetKernelArg(run->pack_bits_kernel, 0, sizeof(cl_mem), (void*) &run->part[0].samples_d);
+        err |= clSetKernelArg(run->pack_bits_kernel, 2, sizeof(cl_uint), (void*) &opt->nsamples);
+        err |= clSetKernelArg(run->pack_bits_kernel, 3, sizeof(cl_mem), (void*) &run->bits_d);
+        err |= clSetKernelArg(run->pack_bits_kernel, 4, sizeof(cl_mem), (void*) &run->base_d);
+        err |= clSetKernelArg(run->pack_kernel, 0, sizeof(cl_mem), (void*) &run->part[0].samples_d);
+        err |= clSetKernelArg(run->pack_kernel, 2, sizeof(cl_uint), (void*) &opt->nsamples);
+        err |= clSetKernelArg(run->pack_kernel, 3, sizeof(cl_mem), (void*) &run->bits_d);
+        err |= clSetKernelArg(run->pack_kernel, 4, sizeof(cl_mem), (void*) &run->offsets_d);
+        err |= clSetKernelArg(run->pack_kernel, 5, sizeof(cl_mem), (void*) &run->packed_d);
+        if (err != CL_SUCCESS)
+        {
+            printf("Error: Failed to set kernel arguments! %d\n", err);
+            exit(1);
+        }
+    }
+
+    // Set the arguments to the compute kernel of every part (count, traj_base
+    // and span are set per launch)
+    //
+    err = 0;
+    for (int k=0; k<run->nparts; k++)
+    {
+        struct ssa_part *p = &run->part[k];
+        cl_kernel kernel = p->kernel;
+
+        err |= clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*) &p->x_d);
+        err |= clSetKernelArg(kernel, 1, sizeof(cl_mem),(void*) &p->ftime_d);
+        err |= clSetKernelArg(kernel, 3, sizeof(cl_ulong),(void*) &opt->seed);
+        err |= clSetKernelArg(kernel, 5, sizeof(cl_mem),(void*) &p->counters_d);
+        err |= clSetKernelArg(kernel, 6, sizeof(cl_mem),(void*) &rates_d);
+        err |= clSetKernelArg(kernel, 7, sizeof(cl_uint),(void*) &nrep);
+        if (opt->sens)
+        {
+            err |= clSetKernelArg(kernel, 9, sizeof(cl_mem),(void*) &p->y_d);
+            err |= clSetKernelArg(kernel, 10, sizeof(cl_mem),(void*) &p->rng_d);
+        }
+        else
+        {
+            err |= clSetKernelArg(kernel, 9, sizeof(cl_mem),(void*) &p->rng_d);
+            err |= clSetKernelArg(kernel, 10, sizeof(cl_mem),(void*) &p->done_d);
+            err |= clSetKernelArg(kernel, 13, sizeof(cl_mem),(void*) &p->samples_d);
+            err |= clSetKernelArg(kernel, 14, sizeof(cl_uint),(void*) &opt->nsamples);
+            err |= clSetKernelArg(kernel, 15, sizeof(cl_mem),(void*) &p->order_d);
+            err |= clSetKernelArg(kernel, 16, sizeof(cl_mem),(void*) &p->progress_d);
+        }
+    }
+    if (err != CL_SUCCESS)
+    {
+        printf("Error: Failed to set kernel arguments! %d\n", err);
+        exit(1);
+    }
+}
+
+/* frees what create_buffers allocated */
+static void release_buffers(struct ssa_run *run)
+{
+    free(run->x_h);
+    free(run->ftime_h);
+    free(run->counters_h);
+    free(run->done_h);
+    free(run->rng_h);
+    free(run->order_h);
+    free(run->cost_h);
+    free(run->y_h);
+    free(run->samples_h);
+    free(run->bits_h);
+    free(run->base_h);
+    free(run->offsets_h);
+    free(run->packed_h);
+    run->x_h = run->counters_h = run->done_h = run->y_h = run->samples_h = run->base_h = NULL;
+    run->ftime_h = NULL;
+    run->rng_h = NULL;
+    run->order_h = run->bits_h = run->offsets_h = run->packed_h = NULL;
+    run->cost_h = NULL;
+    for (int k=0; k<run->nparts; k++)
+    {
+        struct ssa_part *p = &run->part[k];
+
+        CL_CHECK(clReleaseMemObject(p->x_d));
+        CL_CHECK(clReleaseMemObject(p->ftime_d));
+        CL_CHECK(clReleaseMemObject(p->counters_d));
+        CL_CHECK(clReleaseMemObject(p->done_d));
+        CL_CHECK(clReleaseMemObject(p->rng_d));
+        CL_CHECK(clReleaseMemObject(p->order_d));
+        CL_CHECK(clReleaseMemObject(p->samples_d));
+        if (p->y_d) CL_CHECK(clReleaseMemObject(p->y_d));
+        CL_CHECK(clReleaseMemObject(p->progress_d));
+        p->y_d = NULL;
+    }
+    if (run->pack_kernel)
+    {
+        CL_CHECK(clReleaseMemObject(run->bits_d));
+        CL_CHECK(clReleaseMemObject(run->base_d));
+        CL_CHECK(clReleaseMemObject(run->offsets_d));
+        CL_CHECK(clReleaseMemObject(run->packed_d));
+        CL_CHECK(clReleaseKernel(run->pack_bits_kernel));
+        CL_CHECK(clReleaseKernel(run->pack_kernel));
+        run->pack_kernel = run->pack_bits_kernel = NULL;
+    }
+}
+
+/*
+ * Expected reactions of the n trajectories from first on, by
+ * expected_steps of the rows of table (row_size floats per set, the
+ * rates the trajectories run first); a trajectory that fires none
+ * still costs a step.
+ */
+static double range_steps(const struct ssa_run *run, const float *table, size_t row_size,
+                          cl_ulong first, cl_ulong n)
+{
+    const cl_ulong nrep = run->opt->nrep;
+    double steps = 0.0;
+
+    for (cl_ulong t = first; t < first + n; ) {
+        cl_ulong set = t / nrep;
+        cl_ulong end = (set + 1) * nrep < first + n ? (set + 1) * nrep : first + n;
+
+        steps += (double) (end - t) * (expected_steps(table + set*row_size) + 1.0);
+        t = end;
+    }
+    return steps;
+}
+
+/*
+ * Pilot run (--pilot): runs the first opt->pilot trajectories of the
+ * range as one launch, results discarded, and measures the device rate
+ * in steps per second of kernel time. The steps of the whole run are
+ * the pilot's, scaled by the expected steps of the run over those of
+ * the pilot. From them --launch-limit sizes the batch (unless given)
+ * and the slice (unless --max-steps is given), and --budget refuses a
+ * run estimated over it.
+ */
+static void run_pilot(struct ssa_run *run, struct ssa_options *opt, cl_context context,
+                      cl_program program, cl_mem rates_d, const float *table, size_t row_size)
+{
+    const struct ssa_options saved = *opt;
+    const cl_uint n = (cl_uint) (opt->pilot < opt->ntraj ? opt->pilot : opt->ntraj);
+    double pilot_steps = 0.0;
+
+    // a plain launch: nothing printed, stored, checkpointed or offloaded
+    opt->print = 0;
+    opt->store = NULL;
+    opt->checkpoint = NULL;
+    opt->tail_fraction = 0.0;
+    opt->progress_interval = 0.0;
+    opt->batch = n;
+    create_buffers(run, context, program, rates_d);
+    run_launch(run, opt->first, (cl_uint) opt->nrep, n, 0);
+    for (cl_uint i=0; i<n; i++) pilot_steps += run->counters_h[i];
+    release_buffers(run);
+    *opt = saved;
+
+    const double seconds = run->kernel_time * 1e-9;
+    run->kernel_time = 0.0;
+    for (size_t i=0; i<run->nsets*run->nobs; i++) ssa_stats_init(&run->stats[i]);
+    if (!(seconds > 0.0) || !(pilot_steps > 0.0)) {
+        printf("Error: The pilot run of %u trajectories took no measurable time!\n", n);
+        exit(1);
+    }
+
+    const double rate = pilot_steps / seconds;
+    const double steps = pilot_steps * range_steps(run, table, row_size, opt->first, opt->ntraj)
+                       / range_steps(run, table, row_size, opt->first, n);
+    const double mean = steps / opt->ntraj;     // per trajectory
+    const double estimate = steps / rate;
+
+    printf("pilot: %u trajectories, %.0f steps each, %.3g steps/s\n", n, pilot_steps / n, rate);
+    printf("pilot: the run needs about %.3g steps, %.1f s of kernel time\n", steps, estimate);
+    if (opt->budget > 0.0 && estimate > opt->budget) {
+        printf("Error: The run is estimated at %.1f s of kernel time, over the --budget of %g s!\n",
+               estimate, opt->budget);
+        exit(1);
+    }
+    if (opt->budget > 0.0 && estimate > BUDGET_WARN * opt->budget)
+        printf("Warning: The run is estimated at %.0f%% of the --budget of %g s\n",
+               100.0 * estimate / opt->budget, opt->budget);
+
+    if (opt->launch_limit > 0.0) {
+        const double limit_steps = opt->launch_limit * rate;  // steps of a launch or slice
+
+        // below the pilot's size a launch would run under the measured rate
+        if (!opt->batch_given) {
+            double b = floor(limit_steps / mean);
+            opt->batch = b < n ? n : (b > opt->ntraj ? opt->ntraj : (size_t) b);
+        }
+        if (opt->batch * mean > limit_steps && !opt->max_steps_given) {
+            double m = floor(limit_steps / opt->batch);
+            cl_uint slice = m < 1.0 ? 1 : (m > UINT32_MAX ? UINT32_MAX : (cl_uint) m);
+            if (opt->max_steps == 0 || slice < opt->max_steps) opt->max_steps = slice;
+        }
+        printf("pilot: --batch %zu --max-steps %u for launches of about %g s\n",
+               opt->batch, opt->max_steps, opt->launch_limit);
+    }
+}
+
 int main(int argc, char** argv)
 {
     int err;                            // error code returned from api calls
-    size_t localsize, globalsize;
-      
-    unsigned int numWorkItems = NTHREADS;      // total number of work-items
+    struct ssa_options opt;
+    struct ssa_run run;
+
+    parse_options(argc, argv, &opt);
+
+    size_t nsets, nbase;
+    float *rates_h = get_rate_table(&opt, &nbase);
+    float *cfd_h = NULL;
+    double *h = NULL;
+    int cfd_channels[NCHANNEL];
+
+    nsets = nbase;
+    if (opt.sens) {
+        cfd_h = get_cfd_table(&opt, rates_h, nbase, cfd_channels, &nsets);
+        h = (double*) malloc(nsets*sizeof(double));
+        for (size_t row=0; row<nsets; row++) {
+            const float *k = cfd_h + row*2*NCHANNEL;
+            int ch = cfd_channels[row % (nsets / nbase)];
+            h[row] = (double) k[NCHANNEL+ch] - (double) k[ch];
+        }
+    }
+    const int nsens = (int) (nsets / nbase);
+    cl_ulong total = (cl_ulong) nsets * opt.nrep;   // trajectories in the whole sweep
+
+    if (opt.first >= total) {
+        printf("Error: First trajectory %llu is past the end of the sweep (%llu)!\n",
+               (unsigned long long)opt.first, (unsigned long long)total);
+        exit(1);
+    }
+    if (opt.ntraj == 0 || opt.ntraj > total - opt.first) opt.ntraj = total - opt.first;
+    if (opt.adaptive) {
+        if (opt.round_reps == 0) opt.round_reps = (opt.nrep + 15) / 16;
+        if (opt.round_reps > opt.nrep) opt.round_reps = opt.nrep;
+        if (opt.batch == 0) opt.batch = nsets * opt.round_reps;
+    }
+    if (opt.batch == 0 || opt.batch > opt.ntraj) opt.batch = opt.ntraj;
+#if SSA_RNG == SSA_RNG_TINYMT
+    if (opt.first + opt.ntraj - 1 > TINYMT32J_MAX_TRAJ) {
+        printf("Error: TinyMT streams support trajectory indices up to %llu!\n",
+               (unsigned long long) TINYMT32J_MAX_TRAJ);
+        exit(1);
+    }
+#endif
+    uint32_t *tinymt_params = NULL;
+#if SSA_RNG == SSA_RNG_TINYMT_WP
+    // one parameter set per trajectory, loaded once for the whole run
+    size_t ntinymt_params = 0;
+    tinymt_params = tinymt32wp_params_get(opt.tinymt_params, PARAMS_CACHE_DIR, &ntinymt_params);
+    if (!tinymt_params)
+    {
+        printf("Error: Failed to read TinyMT parameter sets from %s!\n", opt.tinymt_params);
+        exit(1);
+    }
+    if (opt.first + opt.ntraj > ntinymt_params)
+    {
+        printf("Error: %s has %zu TinyMT parameter sets, trajectories up to %llu need one each!\n",
+               opt.tinymt_params, ntinymt_params, (unsigned long long)(opt.first + opt.ntraj - 1));
+        exit(1);
+    }
+#endif
+
+    // the checkpoint must come from the same run: seed, sweep and slicing
+    struct ssa_checkpoint ck;
+    uint64_t rates_hash = ssa_hash64(opt.sens ? cfd_h : rates_h,
+            sizeof(float)*(opt.sens ? 2*NCHANNEL : NCHANNEL)*nsets, 0);
+    memset(&ck, 0, sizeof(ck));
+    if (opt.resume)
+    {
+        int r = ssa_checkpoint_read(opt.checkpoint, &ck);
+        if (r < 0)
+        {
+            printf("Error: %s is not a checkpoint of this build!\n", opt.checkpoint);
+            exit(1);
+        }
+        if (r > 0)
+        {
+            printf("No checkpoint %s yet, starting from the beginning\n", opt.checkpoint);
+            opt.resume = 0;
+        }
+        else
+        {
+            if (!opt.seed_given) opt.seed = ck.seed;
+            if (ck.seed != opt.seed || ck.nsets != nsets || ck.nrep != opt.nrep
+                || ck.first != opt.first || ck.ntraj != opt.ntraj || ck.batch != opt.batch
+                || ck.rates_hash != rates_hash || ck.nobs != (opt.sens ? NX : NX+1)
+                || ck.nsamples != opt.nsamples)
+            {
+                printf("Error: %s was written by a different run (seed, sweep, range, batch or samples)!\n",
+                       opt.checkpoint);
+                exit(1);
+            }
+            printf("Resuming from %s at trajectory %llu\n", opt.checkpoint,
+                   (unsigned long long)(opt.first + ck.traj_done));
+        }
+    }
 
     cl_device_id device_id;             // compute device id 
+    cl_device_id *sub_devices = NULL;   // one per NUMA node (--numa)
     cl_context context;                 // compute context
-    cl_command_queue queue;          // compute command queue
     cl_program program;                 // compute program
-    cl_kernel kernel;                   // compute kernel
-    
-    cl_mem x_array_d;                       // device memory used for the input array
-    cl_mem finalT_array_d;                      // device memory used for the output array
-    
+
 	cl_platform_id platforms[100];
 	cl_uint platforms_n = 0;
 	CL_CHECK(clGetPlatformIDs(100, platforms, &platforms_n));
@@ -162,7 +2086,7 @@ int main(int argc, char** argv)
 
 	cl_device_id devices[100];
 	cl_uint devices_n = 0;
-	CL_CHECK(clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, 100, devices, &devices_n));
+	CL_CHECK(clGetDeviceIDs(platforms[0], opt.device_type, 100, devices, &devices_n));
 
 #if 0
 	printf("=== %d OpenCL device(s) found on platform:\n", devices_n);
@@ -195,147 +2119,311 @@ int main(int argc, char** argv)
     // Connect to a compute device
     //
     device_id = devices[0];
-    CL_CHECK(clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, 1, &device_id, NULL));
+    CL_CHECK(clGetDeviceIDs(platforms[0], opt.device_type, 1, &device_id, NULL));
+
+    // One part per NUMA node, else the whole device
+    //
+    memset(&run, 0, sizeof(run));
+    run.nparts = 1;
+    if (opt.numa)
+    {
+        cl_uint n = numa_sub_devices(device_id, &sub_devices);
+        if (n == 0)
+            printf("--numa: the device has no NUMA nodes to partition, running on the whole device\n");
+        else
+            run.nparts = (int) n;
+    }
+    run.part = (struct ssa_part*) calloc(run.nparts, sizeof(struct ssa_part));
+    for (int k=0; k<run.nparts; k++)
+        run.part[k].device = sub_devices ? sub_devices[k] : device_id;
 
     // Create a compute context 
     //
-    context = clCreateContext(0, 1, &device_id, NULL, NULL, &err);
+    cl_device_id *context_devices = sub_devices ? sub_devices : &device_id;
+    context = clCreateContext(0, run.nparts, context_devices, NULL, NULL, &err);
     if (!context)
     {
         printf("Error: Failed to create a compute context! Error code %d\n", err);
         return EXIT_FAILURE;
     }
 
-    // Create a command queue
+    // Report the kernels' resources instead of running
     //
-    queue = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &err);
-    if (!queue)
+    if (opt.kernel_info)
     {
-        printf("Error: Failed to create a command queue!\n");
-        return EXIT_FAILURE;
+        FILE *out = strcmp(opt.kernel_info, "-") == 0 ? stdout : fopen(opt.kernel_info, "w");
+        if (!out)
+        {
+            printf("Error: Failed to open %s!\n", opt.kernel_info);
+            exit(1);
+        }
+        write_kernel_info(out, context, run.part[0].device);
+        if (out != stdout && fclose(out) != 0)
+        {
+            printf("Error: Failed to write %s!\n", opt.kernel_info);
+            exit(1);
+        }
+        CL_CHECK(clReleaseContext(context));
+        return 0;
+    }
+
+    // Create a command queue per part
+    //
+    for (int k=0; k<run.nparts; k++)
+    {
+        run.part[k].queue = clCreateCommandQueue(context, run.part[k].device, CL_QUEUE_PROFILING_ENABLE, &err);
+        if (!run.part[k].queue)
+        {
+            printf("Error: Failed to create a command queue!\n");
+            return EXIT_FAILURE;
+        }
+        if (opt.progress_interval > 0.0)
+        {
+            run.part[k].monitor_queue = clCreateCommandQueue(context, run.part[k].device, 0, &err);
+            if (!run.part[k].monitor_queue)
+            {
+                printf("Error: Failed to create a command queue!\n");
+                return EXIT_FAILURE;
+            }
+        }
     }
 
     // Create the compute program from the source 
     //
-    program = build_program(context, device_id, PROGRAM_FILE);
+    if (opt.kernel == KERNEL_AUTO)
+        opt.kernel = (NCHANNEL >= SSA_SG_MIN_CHANNELS && !opt.sens && device_has_subgroups(device_id))
+            ? KERNEL_SUBGROUP : KERNEL_ITEM;
+    if (opt.kernel == KERNEL_SUBGROUP && !device_has_subgroups(device_id)) {
+        printf("Error: The device does not support sub-groups (--kernel subgroup)!\n");
+        exit(1);
+    }
+    char build_options[128];
+    snprintf(build_options, sizeof(build_options), "-DSSA_ITEMS_PER_WI=%u -DSSA_PROGRESS=%d%s",
+             opt.items_per_wi, opt.progress_interval > 0.0, opt.kernel == KERNEL_SUBGROUP ? " -DSSA_SG_KERNEL=1 -cl-std=CL2.0" : "");
+    program = build_program(context, run.part[0].device, PROGRAM_FILE, build_options);
     if (!program)
     {
         printf("Error: Failed to create compute program!\n");
         return EXIT_FAILURE;
     }
 
-    // Create the compute kernel in the program we wish to run
+    // Create the compute kernel in the program we wish to run, one per
+    // part as every part binds its own buffers
     //
-    kernel = clCreateKernel(program, KERNEL_FUNC, &err);
-    if (!kernel || err != CL_SUCCESS)
+    for (int k=0; k<run.nparts; k++)
     {
-        printf("Error: Failed to create compute kernel!\n");
-        exit(1);
+        run.part[k].kernel = clCreateKernel(program, opt.sens ? KERNEL_CFD_FUNC
+                                : opt.kernel == KERNEL_SUBGROUP ? KERNEL_SG_FUNC : KERNEL_FUNC, &err);
+        if (!run.part[k].kernel || err != CL_SUCCESS)
+        {
+            printf("Error: Failed to create compute kernel!\n");
+            exit(1);
+        }
     }
 
-    x_array_d = clCreateBuffer(context,  CL_MEM_READ_WRITE, sizeof(int)*NX*NTHREADS, NULL, NULL);
-    if (!x_array_d)
+    // Get the maximum work group size for executing the kernel on the device:
+    // it is launched in groups of XBLOCKSIZE
+    //
+    size_t max_localsize;
+    err = clGetKernelWorkGroupInfo(run.part[0].kernel, run.part[0].device, CL_KERNEL_WORK_GROUP_SIZE,
+                                   sizeof(max_localsize), &max_localsize, NULL);
+    if (err != CL_SUCCESS)
     {
-        printf("Error: Failed to allocate device memory (x_array_d)!\n");
+        printf("Error: Failed to retrieve kernel work group info! %d\n", err);
         exit(1);
-    }    
-
-    finalT_array_d = clCreateBuffer(context,  CL_MEM_WRITE_ONLY, sizeof(float)*NTHREADS, NULL, NULL);
-    if (!finalT_array_d)
+    }
+    if (max_localsize < XBLOCKSIZE)
     {
-        printf("Error: Failed to allocate device memory (finalT_array_d)!\n");
+        printf("Error: The kernel runs in work groups of at most %zu on this device, XBLOCKSIZE is %d (see --kernel-info)!\n",
+               max_localsize, XBLOCKSIZE);
         exit(1);
-    }    
-
-    int* x_array_h = (int*) malloc(NTHREADS*NX*sizeof(int));
-    init_x_array(x_array_h);
-    clEnqueueWriteBuffer(queue, x_array_d, CL_TRUE, 0, NTHREADS*NX*sizeof(int), x_array_h, 0, NULL, NULL); 
-
-    float* finalT_array_h = (float*) malloc(NTHREADS*sizeof(float));
+    }
 
-    int* counter_array_h = (int*) malloc(NTHREADS*sizeof(int));
-    cl_mem counter_array_d;                       // device memory used for the input array
-    counter_array_d = clCreateBuffer(context,  CL_MEM_READ_WRITE, sizeof(int)*NTHREADS, NULL, NULL);
 
-    // Set the arguments to our compute kernel
+    // statistics of the run; host arrays and device buffers hold one launch
     //
-    unsigned int seed = (unsigned) time(NULL);
-    err = 0;
-    err  = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*) &x_array_d);
-    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem),(void*) &finalT_array_d);
-    err |= clSetKernelArg(kernel, 2, sizeof(unsigned int),(void*) &numWorkItems);
-    err |= clSetKernelArg(kernel, 3, sizeof(unsigned int),(void*) &seed);
-    err |= clSetKernelArg(kernel, 4, sizeof(cl_mem),(void*) &counter_array_d);
-    if (err != CL_SUCCESS)
+    run.opt = &opt;
+    run.nsets = nsets;
+    run.nobs = opt.sens ? NX : NX+1;    // species (and steps) / derivatives
+    run.h = h;
+    run.stats = (ssa_stats_t*) malloc(nsets*run.nobs*sizeof(ssa_stats_t));
+    for (size_t i=0; i<nsets*run.nobs; i++) ssa_stats_init(&run.stats[i]);
+    run.tinymt_params = tinymt_params;
+    run.rates = rates_h;
+    run.rates_hash = rates_hash;
+    run.checkpoint_last = wall_time();
+    if (opt.numa && run.nparts > 1)
+        printf("--numa: %d sub-devices, one per NUMA node\n", run.nparts);
+
+    // rate constants of every parameter set, one row per set (nominal and
+    // perturbed rates per row with --sensitivity)
+    const size_t row_size = opt.sens ? 2*NCHANNEL : NCHANNEL;
+    cl_mem rates_d = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+            sizeof(float)*row_size*nsets, opt.sens ? cfd_h : rates_h, NULL);
+    if (!rates_d)
     {
-        printf("Error: Failed to set kernel arguments! %d\n", err);
+        printf("Error: Failed to allocate device memory (rates_d)!\n");
         exit(1);
     }
 
-    // Get the maximum work group size for executing the kernel on the device
-    // err = clGetKernelWorkGroupInfo(kernel, device_id, CL_KERNEL_WORK_GROUP_SIZE, 
-    //                                  sizeof(localsize), &localsize, NULL);
-    // if (err != CL_SUCCESS)
-    // {
-    //     printf("Error: Failed to retrieve kernel work group info! %d\n", err);
-    //     exit(1);
-    // }
+    if (opt.pilot > 0)
+        run_pilot(&run, &opt, context, program, rates_d, opt.sens ? cfd_h : rates_h, row_size);
+    create_buffers(&run, context, program, rates_d);
 
-    // Number of total work items - localSize must be devisor
-    //globalsize = ceil(numWorkItems/(float)localsize)*localsize;
-
-    localsize = XBLOCKSIZE;
-    globalsize = numWorkItems;
-    printf("global size=%lu, local size=%lu\n", globalsize, localsize);
+    if (opt.adaptive)
+        printf("seed=%llu, %zu parameter set(s) x up to %zu trajectories, %zu per round\n",
+               (unsigned long long)opt.seed, nsets, opt.nrep, opt.round_reps);
+    else
+        printf("seed=%llu, %zu parameter set(s) x %zu trajectories, running %llu..%llu\n",
+               (unsigned long long)opt.seed, nsets, opt.nrep,
+               (unsigned long long)opt.first, (unsigned long long)(opt.first + opt.ntraj - 1));
+    cl_uint nrep = (cl_uint) opt.nrep;
 
+    // columnar results, one row per trajectory in the order they run
+    ssa_store_t store;
+    if (opt.store)
+    {
+        struct ssa_store_header sh;
 
+        ssa_store_init(&sh);
+        sh.model_hash = ssa_model_hash(PROGRAM_FILE, x);
+        sh.rates_hash = rates_hash;
+        sh.seed = opt.seed;
+        sh.nsets = nsets;
+        sh.nrep = opt.nrep;
+        sh.first = opt.first;
+        sh.capacity = opt.ntraj;
+        sh.nx = NX;
+        sh.nchannel = NCHANNEL;
+        sh.nsamples = opt.nsamples;
+        sh.rng = SSA_RNG;
+        sh.sens = opt.sens;
+        sh.finaltime = FINALTIME;
+        ssa_store_add_result_columns(&sh, opt.pack);    // written in order by store_launch
+        if (ssa_store_create(&store, opt.store, &sh, opt.sens ? cfd_h : rates_h, opt.resume) != 0)
+            exit(1);
+        // rows written after the checkpoint are written again
+        if (opt.resume && ssa_store_rewind(&store, ck.traj_done) != 0)
+        {
+            printf("Error: Failed to resume store %s!\n", opt.store);
+            exit(1);
+        }
+        run.store = &store;
+        run.column_h = (int*) malloc(opt.batch*sizeof(int));
+    }
 
-    /* Enqueue kernel with profiling event   */
-    cl_event kernel_completion;
-    cl_ulong time_start, time_end;
+    if (opt.progress_interval > 0.0)
+    {
+        run.progress.total = opt.adaptive ? (cl_ulong) nsets * opt.nrep : opt.ntraj;
+        run.progress.resumed = opt.resume ? ck.traj_done : 0;
+        run.progress.start = wall_time();
+        pthread_mutex_init(&run.progress.lock, NULL);
+        pthread_cond_init(&run.progress.wake, NULL);
+        if (pthread_create(&run.progress.thread, NULL, progress_thread, &run) != 0)
+        {
+            printf("Error: Failed to start the progress thread!\n");
+            exit(1);
+        }
+    }
 
-    //printf("Random numbers generated inside kernel:\n");
-    err = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &globalsize, &localsize, 0, NULL, &kernel_completion); 
-    clFinish(queue);
+    if (opt.adaptive)
+    {
+        run_adaptive(&run);
+    }
+    else
+    {
+        size_t b = 0;
 
-    CL_CHECK(clWaitForEvents(1, &kernel_completion));
+        if (opt.resume)
+        {
+            // statistics of the finished launches and the state of the one in flight
+            memcpy(run.stats, ck.stats, nsets*run.nobs*sizeof(ssa_stats_t));
+            run.kernel_time = ck.kernel_time;
+            b = ck.traj_done;
+            run.store_rows = b;
+            if (ck.count > 0)
+            {
+                run.traj_done = b;
+                memcpy(run.x_h, ck.x, ck.count*NX*sizeof(int));
+                memcpy(run.ftime_h, ck.ftime, ck.count*sizeof(float));
+                memcpy(run.counters_h, ck.counters, ck.count*sizeof(int));
+                memcpy(run.done_h, ck.done, ck.count*sizeof(int));
+                memcpy(run.rng_h, ck.rng, ck.count*SSA_RNG_STATE_WORDS*sizeof(uint32_t));
+                if (opt.nsamples > 0)
+                    memcpy(run.samples_h, ck.samples, NX*ck.count*opt.nsamples*sizeof(int));
+                run_launch(&run, opt.first + b, nrep, ck.count, 1);
+                b += ck.count;
+            }
+            ssa_checkpoint_free(&ck);
+        }
 
-    CL_CHECK(clGetEventProfilingInfo(kernel_completion, CL_PROFILING_COMMAND_START,
-               sizeof(time_start), &time_start, NULL));
-    CL_CHECK(clGetEventProfilingInfo(kernel_completion, CL_PROFILING_COMMAND_END,
-               sizeof(time_end), &time_end, NULL));
+        for (; b < opt.ntraj; b += opt.batch)
+        {
+            cl_uint count = (cl_uint) (opt.ntraj - b < opt.batch ? opt.ntraj - b : opt.batch);
+            run.traj_done = b;
+            if (checkpoint_due(&run)) save_checkpoint(&run, 0);
+            run_launch(&run, opt.first + b, nrep, count, 0);
+        }
+        finish_tail(&run);
 
-    double exe_time = time_end - time_start;
-    printf("Kernel exec time = %.3f msec\n", exe_time/1000000.0);
+        // the run is complete: a stale checkpoint must not be resumed
+        if (opt.checkpoint) remove(opt.checkpoint);
+    }
 
-    /* Read the kernel's output    */
-    clEnqueueReadBuffer(queue, x_array_d, CL_TRUE, 0, NX*NTHREADS*sizeof(int), x_array_h, 0, NULL, NULL); 
-    clEnqueueReadBuffer(queue, finalT_array_d, CL_TRUE, 0, NTHREADS*sizeof(float), finalT_array_h, 0, NULL, NULL); 
-    clEnqueueReadBuffer(queue, counter_array_d, CL_TRUE, 0, NTHREADS*sizeof(int), counter_array_h, 0, NULL, NULL); 
+    if (opt.progress_interval > 0.0)
+    {
+        pthread_mutex_lock(&run.progress.lock);
+        run.progress.stop = 1;
+        pthread_cond_signal(&run.progress.wake);
+        pthread_mutex_unlock(&run.progress.lock);
+        pthread_join(run.progress.thread, NULL);
+    }
 
-#if 0
-    //printf("numbers returned to host:\n");
-    for (int i=0; i<numWorkItems; i++) {
-        for (int j=0; j<NX; j++) {
-            printf("%d ", x_array_h[i*NX+j]);
-        }
-        printf(", %d, ", counter_array_h[i]);
-        printf("%f\n", finalT_array_h[i]);
+    if (run.store && ssa_store_close(run.store, run.store_rows) != 0)
+    {
+        printf("Error: Failed to write store %s!\n", opt.store);
+        exit(1);
     }
-#endif
+
+    printf("Kernel exec time = %.3f msec\n", run.kernel_time/1000000.0);
+    if (opt.tail_fraction > 0.0)
+        printf("Tail offload: %llu trajectories finished on %d host threads, %llu steps\n",
+               (unsigned long long)run.tail_traj, opt.tail_threads, (unsigned long long)run.tail_steps);
+
+    if (opt.sens)
+        print_cfd_summary(&run, cfd_h, cfd_channels, nsens);
+    else
+        print_set_summary(&run, rates_h);
 
     // Shutdown and cleanup
     //
-    free(x_array_h);
-    free(finalT_array_h);
-    CL_CHECK(clReleaseEvent(kernel_completion));
-    CL_CHECK(clReleaseMemObject(x_array_d));
-    CL_CHECK(clReleaseMemObject(finalT_array_d));
+    release_buffers(&run);
+    free(tinymt_params);
+    free(run.tail.x);
+    free(run.tail.ftime);
+    free(run.tail.counters);
+    free(run.tail.done);
+    free(run.tail.rng);
+    free(run.tail.samples);
+    free(run.column_h);
+    free(run.stats);
+    free(rates_h);
+    free(cfd_h);
+    free(h);
+    for (int k=0; k<run.nparts; k++)
+    {
+        struct ssa_part *p = &run.part[k];
+
+        if (p->monitor_queue) CL_CHECK(clReleaseCommandQueue(p->monitor_queue));
+        CL_CHECK(clReleaseKernel(p->kernel));
+        CL_CHECK(clReleaseCommandQueue(p->queue));
+        if (sub_devices) CL_CHECK(clReleaseDevice(p->device));
+    }
+    CL_CHECK(clReleaseMemObject(rates_d));
     CL_CHECK(clReleaseProgram(program));
-    CL_CHECK(clReleaseKernel(kernel));
-    CL_CHECK(clReleaseCommandQueue(queue));
     CL_CHECK(clReleaseContext(context));
+    free(run.part);
+    free(sub_devices);
 
     return 0;
 }
-
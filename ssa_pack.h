@@ -0,0 +1,144 @@
+#ifndef SSA_PACK_H
+#define SSA_PACK_H
+/**
+ *  FILE:    ssa_pack.h
+ *
+ *  SUMMARY: Time series codec of species counts, the host side of
+ *           ssa_pack.clh. A row of n samples is stored as its first
+ *           value (base) and the n-1 differences of consecutive samples,
+ *           zigzag encoded and bit-packed with the width of the largest
+ *           one, least significant bit first, into 32-bit words.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* maps small signed values to small unsigned ones: 0,-1,1,-2 -> 0,1,2,3 */
+inline static uint32_t ssa_zigzag(int32_t v)
+{
+    return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31);
+}
+
+inline static int32_t ssa_unzigzag(uint32_t u)
+{
+    return (int32_t) (u >> 1) ^ -(int32_t) (u & 1);
+}
+
+/* zigzag code of b - a, taken modulo 2^32 so any two counts have one */
+inline static uint32_t ssa_zigzag_diff(int32_t a, int32_t b)
+{
+    return ssa_zigzag((int32_t) ((uint32_t) b - (uint32_t) a));
+}
+
+/* packed words of a row of n samples with bits bits per difference */
+inline static size_t ssa_pack_words(uint32_t n, uint32_t bits)
+{
+    return (n < 2) ? 0 : ((size_t) (n - 1) * bits + 31) / 32;
+}
+
+/* bits per difference of the row x[0..n-1] */
+inline static uint32_t ssa_pack_bits(const int32_t *x, uint32_t n)
+{
+    uint32_t acc = 0, bits = 0;
+
+    for (uint32_t k = 1; k < n; k++)
+        acc |= ssa_zigzag_diff(x[k-1], x[k]);
+    while (bits < 32 && (acc >> bits))
+        bits++;
+    return bits;
+}
+
+/* packs the differences of x[0..n-1] into ssa_pack_words(n, bits) words */
+inline static void ssa_pack_row(const int32_t *x, uint32_t n, uint32_t bits, uint32_t *words)
+{
+    uint64_t buf = 0;
+    uint32_t nbuf = 0;
+
+    for (uint32_t k = 1; k < n; k++) {
+        buf |= (uint64_t) ssa_zigzag_diff(x[k-1], x[k]) << nbuf;
+        nbuf += bits;
+        if (nbuf >= 32) {
+            *words++ = (uint32_t) buf;
+            buf >>= 32;
+            nbuf -= 32;
+        }
+    }
+    if (nbuf > 0)
+        *words = (uint32_t) buf;
+}
+
+/* difference k (1..n-1) of a packed row: the field at bit (k-1)*bits */
+inline static int32_t ssa_unpack_field(const uint32_t *words, size_t nwords, uint32_t bits, uint32_t k)
+{
+    const uint64_t mask = ((uint64_t) 1 << bits) - 1;
+    size_t pos = (size_t) (k - 1) * bits;
+    size_t w = pos >> 5;
+    uint64_t win = words[w];
+
+    if (w + 1 < nwords)
+        win |= (uint64_t) words[w + 1] << 32;
+    return ssa_unzigzag((uint32_t) ((win >> (pos & 31)) & mask));
+}
+
+/*
+ * Decodes a packed row into x[0..n-1]. The fields are independent of
+ * each other: with AVX2 eight are extracted per step, each from a 64-bit
+ * gather of the two words holding it, shifted and masked per lane; the
+ * fields whose second word would be past the row, and every field
+ * without AVX2, are extracted one at a time. Only the final prefix sum
+ * is sequential.
+ */
+inline static void ssa_unpack_row(const uint32_t *words, uint32_t bits, int32_t base,
+                                  uint32_t n, int32_t *x)
+{
+    const size_t nwords = ssa_pack_words(n, bits);
+    uint32_t k = 1;
+
+    if (n == 0)
+        return;
+    x[0] = base;
+    if (bits == 0) {
+        for (k = 1; k < n; k++) x[k] = base;
+        return;
+    }
+#if defined(__AVX2__)
+    // positions are 32-bit lanes: rows of up to 2^31 bits
+    if ((uint64_t) n * bits < ((uint64_t) 1 << 31)) {
+        const __m256i mask = _mm256_set1_epi64x((long long) (((uint64_t) 1 << bits) - 1));
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i low = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        __m256i pos = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                         _mm256_set1_epi32((int) bits));
+        const __m256i step = _mm256_set1_epi32((int) (8 * bits));
+
+        // the last field of a step must not read its second word past the row
+        for (; k + 8 <= n && (((size_t) (k + 6) * bits) >> 5) + 1 < nwords; k += 8) {
+            __m256i w = _mm256_srli_epi32(pos, 5);
+            __m256i sh = _mm256_and_si256(pos, _mm256_set1_epi32(31));
+            __m256i lo = _mm256_i32gather_epi64((const long long *) words,
+                                                _mm256_castsi256_si128(w), 4);
+            __m256i hi = _mm256_i32gather_epi64((const long long *) words,
+                                                _mm256_extracti128_si256(w, 1), 4);
+            lo = _mm256_and_si256(_mm256_srlv_epi64(lo, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(sh))), mask);
+            hi = _mm256_and_si256(_mm256_srlv_epi64(hi, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sh, 1))), mask);
+            // the low halves of the 64-bit lanes, in order
+            __m256i u = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(lo, low))),
+                    _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(hi, low)), 1);
+            __m256i v = _mm256_xor_si256(_mm256_srli_epi32(u, 1),
+                                         _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(u, one)));
+            _mm256_storeu_si256((__m256i *) (x + k), v);
+            pos = _mm256_add_epi32(pos, step);
+        }
+    }
+#endif
+    for (; k < n; k++)
+        x[k] = ssa_unpack_field(words, nwords, bits, k);
+    for (k = 1; k < n; k++)
+        x[k] = (int32_t) ((uint32_t) x[k] + (uint32_t) x[k-1]);
+}
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ *  FILE:    ssa_pack_check.c
+ *
+ *  SUMMARY: Round trip check of the time series codec (ssa_pack.h):
+ *           rows are packed and unpacked again and must come back
+ *           unchanged, at every width from 0 to 32 bits.
+ *
+ *  NOTES:
+ *      Build it as ssa_store_stats is built, with and without -mavx2, to
+ *      check the vector decoder against the scalar one. Prints the rows
+ *      that fail and exits with 1 if any does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ssa_pack.h"
+
+#define MAX_N 300
+
+static uint32_t rng_state = 12345;
+
+static uint32_t next_u32(void)
+{
+    // xorshift32, enough to vary the rows
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* packs and unpacks x[0..n-1]; returns the number of mismatches */
+static int round_trip(const int32_t *x, uint32_t n, const char *what)
+{
+    uint32_t words[MAX_N + 1];
+    int32_t y[MAX_N];
+    uint32_t bits = ssa_pack_bits(x, n);
+    int bad = 0;
+
+    if (bits > 32) {
+        printf("%s, n=%u: %u bits\n", what, n, bits);
+        return 1;
+    }
+    memset(words, 0, sizeof(words));
+    ssa_pack_row(x, n, bits, words);
+    ssa_unpack_row(words, bits, n ? x[0] : 0, n, y);
+    for (uint32_t k = 0; k < n; k++) {
+        if (y[k] != x[k]) {
+            if (!bad)
+                printf("%s, n=%u, %u bits: sample %u is %d, not %d\n", what, n, bits, k, y[k], x[k]);
+            bad = 1;
+        }
+    }
+    return bad;
+}
+
+int main(void)
+{
+    int32_t x[MAX_N];
+    int bad = 0, rows = 0;
+
+    // differences of every width, at lengths around the vector steps
+    for (uint32_t bits = 0; bits <= 32; bits++) {
+        for (uint32_t n = 0; n <= MAX_N; n += (n < 40) ? 1 : 37) {
+            uint32_t span = (bits == 32) ? UINT32_MAX : ((uint32_t) 1 << bits) - 1;
+
+            x[0] = (int32_t) next_u32();
+            for (uint32_t k = 1; k < n; k++) {
+                uint32_t u = bits ? next_u32() & span : 0;
+                x[k] = (int32_t) ((uint32_t) x[k-1] + (uint32_t) ssa_unzigzag(u));
+            }
+            bad += round_trip(x, n, "random");
+            rows++;
+        }
+    }
+
+    // extremes: the largest difference in either direction
+    x[0] = 0;
+    x[1] = -1073741825;
+    bad += round_trip(x, 2, "2^30 step");
+    for (uint32_t k = 0; k < MAX_N; k++) x[k] = (k & 1) ? INT32_MIN : INT32_MAX;
+    bad += round_trip(x, MAX_N, "INT32_MIN/MAX");
+    for (uint32_t k = 0; k < MAX_N; k++) x[k] = (int32_t) k * 7;
+    bad += round_trip(x, MAX_N, "ramp");
+    rows += 3;
+
+    printf("%d rows, %d bad\n", rows, bad);
+    return bad ? 1 : 0;
+}
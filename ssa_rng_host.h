@@ -0,0 +1,83 @@
+#ifndef SSA_RNG_HOST_H
+#define SSA_RNG_HOST_H
+/**
+ *  FILE:    ssa_rng_host.h
+ *
+ *  SUMMARY: The random number interface of the kernel (ssa_rng.clh)
+ *           compiled as host C, so the host can continue a trajectory
+ *           from the generator state the device left in rng_state.
+ *
+ *  NOTES:
+ *      The OpenCL C that ssa_rng.clh and the generators behind it use is
+ *      mapped to C here: address space qualifiers, the vector-free
+ *      built-ins and the float logs. ssa_rng_t has the layout of one
+ *      SSA_RNG_STATE_WORDS record of the device buffer. The stream of
+ *      uniforms is the device's, bit for bit. The host log is logf,
+ *      while OpenCL allows the device's log an error of 3 ulp, so the
+ *      exponential waiting times agree with the device's in
+ *      distribution, not bit for bit. native_log and half_log may be
+ *      far coarser than that, so ssa_opencl continues trajectories on
+ *      the host with SSA_LOG_FULL only.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "prob_params.h"
+
+// OpenCL C names, defined for the .clh only and undefined after it, so
+// they cannot clash with the host's (e.g. uint of <sys/types.h>)
+#define uint uint32_t
+#define ulong uint64_t
+#define __global
+#define __constant const
+#define get_global_id(d) ((size_t) 0)
+#define get_global_offset(d) ((size_t) 0)
+#define get_global_size(d) ((size_t) 1)
+
+static inline uint32_t ssa_host_mul_hi(uint32_t a, uint32_t b)
+{
+    return (uint32_t) (((uint64_t) a * b) >> 32);
+}
+
+static inline float ssa_host_as_float(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+#define mul_hi(a, b) ssa_host_mul_hi(a, b)
+#define as_float(u) ssa_host_as_float(u)
+#define native_log(x) logf(x)
+#define half_log(x) logf(x)
+#define log(x) logf(x)
+
+// the TinyMT OpenCL headers have unused locals, and declare helpers
+// they never define, which C reports at the end of the file and C++
+// at the declaration
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "ssa_rng.clh"
+#pragma GCC diagnostic pop
+#if SSA_RNG == SSA_RNG_TINYMT
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
+#undef log
+#undef native_log
+#undef half_log
+#undef as_float
+#undef mul_hi
+#undef get_global_size
+#undef get_global_offset
+#undef get_global_id
+#undef __constant
+#undef __global
+#undef ulong
+#undef uint
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef SSA_SIMD_H
+#define SSA_SIMD_H
+/**
+ *  FILE:    ssa_simd.h
+ *
+ *  SUMMARY: Vector types and operations of the lane-parallel CPU engine
+ *           (ssa_cpu --simd): one traits struct per instruction set with
+ *           W lanes of int32 (vi), float (vf) and lane masks (vm), so the
+ *           engine is written once as a template.
+ *
+ *  NOTES:
+ *      simd_avx512 (16 lanes) is defined when compiling with AVX-512F,
+ *      simd_avx2 (8 lanes) with AVX2; SSA_SIMD_LANES is the widest one.
+ *      No operation fuses a multiply and an add, so the arithmetic of
+ *      a lane rounds as the scalar engine's does.
+ */
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+struct simd_avx2 {
+    enum { W = 8 };
+    typedef __m256i vi;
+    typedef __m256 vf;
+    typedef __m256i vm;     // all ones in the selected lanes
+    static const char *name() { return "avx2"; }
+
+    static vi set1(int32_t v) { return _mm256_set1_epi32(v); }
+    static vi load(const int32_t *p) { return _mm256_load_si256((const __m256i *) p); }
+    static void store(int32_t *p, vi v) { _mm256_store_si256((__m256i *) p, v); }
+    static vi add(vi a, vi b) { return _mm256_add_epi32(a, b); }
+    static vi sub(vi a, vi b) { return _mm256_sub_epi32(a, b); }
+    static vi and_(vi a, vi b) { return _mm256_and_si256(a, b); }
+    static vi xor_(vi a, vi b) { return _mm256_xor_si256(a, b); }
+    template<int n> static vi shl(vi a) { return _mm256_slli_epi32(a, n); }
+    template<int n> static vi shr(vi a) { return _mm256_srli_epi32(a, n); }
+    static vm eq(vi a, vi b) { return _mm256_cmpeq_epi32(a, b); }
+    static vm lt(vi a, vi b) { return _mm256_cmpgt_epi32(b, a); }
+    static vi select(vm m, vi a, vi b) { return _mm256_blendv_epi8(b, a, m); }  // m ? a : b
+    static vi ones(vm m) { return _mm256_srli_epi32(m, 31); }                     // m ? 1 : 0
+
+    static vf set1f(float v) { return _mm256_set1_ps(v); }
+    static vf loadf(const float *p) { return _mm256_load_ps(p); }
+    static void storef(float *p, vf v) { _mm256_store_ps(p, v); }
+    static vf addf(vf a, vf b) { return _mm256_add_ps(a, b); }
+    static vf subf(vf a, vf b) { return _mm256_sub_ps(a, b); }
+    static vf mulf(vf a, vf b) { return _mm256_mul_ps(a, b); }
+    static vf divf(vf a, vf b) { return _mm256_div_ps(a, b); }
+    static vf cvt(vi a) { return _mm256_cvtepi32_ps(a); }
+    static vi bits(vf a) { return _mm256_castps_si256(a); }
+    static vf floats(vi a) { return _mm256_castsi256_ps(a); }
+    static vm ltf(vf a, vf b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+    static vm gtf(vf a, vf b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+    static vm lef(vf a, vf b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+    static vf selectf(vm m, vf a, vf b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(m)); }
+
+    static vm or_m(vm a, vm b) { return _mm256_or_si256(a, b); }
+    static vm and_m(vm a, vm b) { return _mm256_and_si256(a, b); }
+    static uint32_t bitmask(vm m) { return (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(m)); }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct simd_avx512 {
+    enum { W = 16 };
+    typedef __m512i vi;
+    typedef __m512 vf;
+    typedef __mmask16 vm;
+    static const char *name() { return "avx512"; }
+
+    static vi set1(int32_t v) { return _mm512_set1_epi32(v); }
+    static vi load(const int32_t *p) { return _mm512_load_si512(p); }
+    static void store(int32_t *p, vi v) { _mm512_store_si512(p, v); }
+    static vi add(vi a, vi b) { return _mm512_add_epi32(a, b); }
+    static vi sub(vi a, vi b) { return _mm512_sub_epi32(a, b); }
+    static vi and_(vi a, vi b) { return _mm512_and_si512(a, b); }
+    static vi xor_(vi a, vi b) { return _mm512_xor_si512(a, b); }
+    template<int n> static vi shl(vi a) { return _mm512_slli_epi32(a, n); }
+    template<int n> static vi shr(vi a) { return _mm512_srli_epi32(a, n); }
+    static vm eq(vi a, vi b) { return _mm512_cmpeq_epi32_mask(a, b); }
+    static vm lt(vi a, vi b) { return _mm512_cmplt_epi32_mask(a, b); }
+    static vi select(vm m, vi a, vi b) { return _mm512_mask_blend_epi32(m, b, a); }
+    static vi ones(vm m) { return _mm512_maskz_set1_epi32(m, 1); }
+
+    static vf set1f(float v) { return _mm512_set1_ps(v); }
+    static vf loadf(const float *p) { return _mm512_load_ps(p); }
+    static void storef(float *p, vf v) { _mm512_store_ps(p, v); }
+    static vf addf(vf a, vf b) { return _mm512_add_ps(a, b); }
+    static vf subf(vf a, vf b) { return _mm512_sub_ps(a, b); }
+    static vf mulf(vf a, vf b) { return _mm512_mul_ps(a, b); }
+    static vf divf(vf a, vf b) { return _mm512_div_ps(a, b); }
+    static vf cvt(vi a) { return _mm512_cvtepi32_ps(a); }
+    static vi bits(vf a) { return _mm512_castps_si512(a); }
+    static vf floats(vi a) { return _mm512_castsi512_ps(a); }
+    static vm ltf(vf a, vf b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static vm gtf(vf a, vf b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static vm lef(vf a, vf b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+    static vf selectf(vm m, vf a, vf b) { return _mm512_mask_blend_ps(m, b, a); }
+
+    static vm or_m(vm a, vm b) { return (vm) (a | b); }
+    static vm and_m(vm a, vm b) { return (vm) (a & b); }
+    static uint32_t bitmask(vm m) { return (uint32_t) m; }
+};
+#endif
+
+#if defined(__AVX512F__)
+#define SSA_SIMD_LANES 16
+typedef simd_avx512 simd_best;
+#elif defined(__AVX2__)
+#define SSA_SIMD_LANES 8
+typedef simd_avx2 simd_best;
+#else
+#define SSA_SIMD_LANES 0
+#endif
+
+/*
+ * Natural log of x in (0, 1] in every lane: Cephes logf, the exponent
+ * split off and a degree 9 polynomial on the mantissa, within 1-2 ulp
+ * of logf.
+ */
+template<class L>
+inline static typename L::vf simd_log(typename L::vf x)
+{
+    typedef typename L::vi vi;
+    typedef typename L::vf vf;
+    const vi xi = L::bits(x);
+    vf e = L::cvt(L::sub(L::template shr<23>(xi), L::set1(126)));
+    vf m = L::floats(L::xor_(L::and_(xi, L::set1(0x007fffff)), L::set1(0x3f000000)));  // [0.5, 1)
+    typename L::vm small = L::ltf(m, L::set1f(0.707106781186547524f));
+
+    e = L::selectf(small, L::subf(e, L::set1f(1.0f)), e);
+    m = L::subf(L::selectf(small, L::addf(m, m), m), L::set1f(1.0f));
+
+    const vf z = L::mulf(m, m);
+    vf y = L::set1f(7.0376836292e-2f);
+    y = L::addf(L::mulf(y, m), L::set1f(-1.1514610310e-1f));
+    y = L::addf(L::mulf(y, m), L::set1f(1.1676998740e-1f));
+    y = L::addf(L::mulf(y, m), L::set1f(-1.2420140846e-1f));
+    y = L::addf(L::mulf(y, m), L::set1f(1.4249322787e-1f));
+    y = L::addf(L::mulf(y, m), L::set1f(-1.6668057665e-1f));
+    y = L::addf(L::mulf(y, m), L::set1f(2.0000714765e-1f));
+    y = L::addf(L::mulf(y, m), L::set1f(-2.4999993993e-1f));
+    y = L::addf(L::mulf(y, m), L::set1f(3.3333331174e-1f));
+    y = L::mulf(L::mulf(y, m), z);
+    y = L::addf(y, L::mulf(e, L::set1f(-2.12194440e-4f)));
+    y = L::subf(y, L::mulf(z, L::set1f(0.5f)));
+    return L::addf(L::addf(m, y), L::mulf(e, L::set1f(0.693359375f)));
+}
+
+#endif
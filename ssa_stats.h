@@ -0,0 +1,62 @@
+#ifndef SSA_STATS_H
+#define SSA_STATS_H
+/**
+ *  FILE:    ssa_stats.h
+ *
+ *  SUMMARY: Running mean and variance of ensemble outputs (Welford's
+ *           algorithm), numerically stable for long runs.
+ */
+
+#include <math.h>
+#include <stddef.h>
+
+typedef struct SSA_STATS_T {
+    size_t n;
+    double mean;
+    double m2;      // sum of squared deviations from the mean
+} ssa_stats_t;
+
+inline static void ssa_stats_init(ssa_stats_t *s)
+{
+    s->n = 0;
+    s->mean = 0.0;
+    s->m2 = 0.0;
+}
+
+inline static void ssa_stats_add(ssa_stats_t *s, double v)
+{
+    double d = v - s->mean;
+    s->n++;
+    s->mean += d / s->n;
+    s->m2 += d * (v - s->mean);
+}
+
+/* merges b into a (Chan et al.) */
+inline static void ssa_stats_merge(ssa_stats_t *a, const ssa_stats_t *b)
+{
+    size_t n = a->n + b->n;
+    double d = b->mean - a->mean;
+
+    if (b->n == 0) return;
+    if (a->n == 0) {
+        *a = *b;
+        return;
+    }
+    a->mean += d * b->n / n;
+    a->m2 += b->m2 + d * d * ((double) a->n * b->n / n);
+    a->n = n;
+}
+
+/* sample standard deviation */
+inline static double ssa_stats_sd(const ssa_stats_t *s)
+{
+    return (s->n > 1) ? sqrt(s->m2 / (s->n - 1)) : 0.0;
+}
+
+/* half width of the normal confidence interval of the mean, z = 1.96 for 95% */
+inline static double ssa_stats_ci(const ssa_stats_t *s, double z)
+{
+    return (s->n > 1) ? z * ssa_stats_sd(s) / sqrt((double) s->n) : INFINITY;
+}
+
+#endif
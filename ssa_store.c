@@ -0,0 +1,288 @@
+/**
+ *  FILE:    ssa_store.c
+ *
+ *  SUMMARY: Columnar binary result store (see ssa_store.h).
+ *
+ *  NOTES:
+ *      The file is sized for all columns up front, so each launch writes
+ *      one contiguous chunk per column with a single pwrite at the offset
+ *      of its first row, and a resumed run writes its rows in place.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ssa_pack.h"
+#include "ssa_store.h"
+
+#define COLUMN_ALIGN 64
+
+static uint64_t align_up(uint64_t v, uint64_t a)
+{
+    return (v + a - 1) / a * a;
+}
+
+size_t ssa_store_row_size(const struct ssa_store_column *c)
+{
+    switch (c->type) {
+    case SSA_STORE_PACKED: return sizeof(struct ssa_store_packed);
+    case SSA_STORE_UINT64: return 8 * (size_t) c->width;
+    default:               return 4 * (size_t) c->width;
+    }
+}
+
+static uint64_t rates_size(const struct ssa_store_header *hdr)
+{
+    return sizeof(float) * hdr->nsets * hdr->nchannel * (hdr->sens ? 2 : 1);
+}
+
+static uint64_t column_end(const struct ssa_store_header *hdr, int col)
+{
+    const struct ssa_store_column *c = &hdr->columns[col];
+    return c->offset + hdr->capacity * ssa_store_row_size(c);
+}
+
+static uint64_t data_end(const struct ssa_store_header *hdr)
+{
+    return hdr->ncolumns ? column_end(hdr, hdr->ncolumns - 1)
+                         : hdr->rates_offset + rates_size(hdr);
+}
+
+void ssa_store_init(struct ssa_store_header *hdr)
+{
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, SSA_STORE_MAGIC, sizeof(hdr->magic));
+    hdr->version = SSA_STORE_VERSION;
+    hdr->header_size = SSA_STORE_HEADER_SIZE;
+    hdr->rates_offset = SSA_STORE_HEADER_SIZE;
+}
+
+int ssa_store_add_column(struct ssa_store_header *hdr, const char *name,
+                         uint32_t type, uint32_t width)
+{
+    struct ssa_store_column *c;
+    uint64_t end;
+
+    if (hdr->ncolumns == SSA_STORE_MAX_COLUMNS)
+        return -1;
+    end = (hdr->ncolumns == 0) ? hdr->rates_offset + rates_size(hdr)
+                               : column_end(hdr, hdr->ncolumns - 1);
+    c = &hdr->columns[hdr->ncolumns];
+    memset(c, 0, sizeof(*c));
+    strncpy(c->name, name, sizeof(c->name) - 1);
+    c->type = type;
+    c->width = width;
+    c->offset = align_up(end, COLUMN_ALIGN);
+    return (int) hdr->ncolumns++;
+}
+
+void ssa_store_add_result_columns(struct ssa_store_header *hdr, int pack)
+{
+    char name[16];
+
+    ssa_store_add_column(hdr, "traj", SSA_STORE_UINT64, 1);
+    for (uint32_t j = 0; j < hdr->nx; j++) {
+        snprintf(name, sizeof(name), "x%u", j);
+        ssa_store_add_column(hdr, name, SSA_STORE_INT32, 1);
+    }
+    for (uint32_t j = 0; j < hdr->nx && hdr->sens; j++) {
+        snprintf(name, sizeof(name), "y%u", j);
+        ssa_store_add_column(hdr, name, SSA_STORE_INT32, 1);
+    }
+    ssa_store_add_column(hdr, "steps", SSA_STORE_INT32, 1);
+    ssa_store_add_column(hdr, "ftime", SSA_STORE_FLOAT32, 1);
+    for (uint32_t j = 0; j < hdr->nx && hdr->nsamples > 0; j++) {
+        snprintf(name, sizeof(name), "x%u_t", j);
+        ssa_store_add_column(hdr, name, pack ? SSA_STORE_PACKED : SSA_STORE_INT32,
+                             hdr->nsamples);
+    }
+}
+
+/* pwrite all of size bytes */
+static int write_at(int fd, const void *data, size_t size, uint64_t offset)
+{
+    const char *p = (const char *) data;
+
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, (off_t) offset);
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= (size_t) n;
+        offset += (uint64_t) n;
+    }
+    return 0;
+}
+
+static int reopen_store(ssa_store_t *st, const char *path)
+{
+    struct ssa_store_header old;
+
+    st->fd = open(path, O_RDWR);
+    if (st->fd < 0) {
+        printf("Error: Failed to open store %s to resume it\n", path);
+        return -1;
+    }
+    if (pread(st->fd, &old, sizeof(old), 0) != (ssize_t) sizeof(old))
+        goto mismatch;
+    old.nrows = st->hdr.nrows;
+    old.blob_words = st->hdr.blob_words;
+    if (memcmp(&old, &st->hdr, sizeof(old)) != 0)
+        goto mismatch;
+    return 0;
+
+mismatch:
+    close(st->fd);
+    printf("Error: %s is not the store of this run!\n", path);
+    return -1;
+}
+
+int ssa_store_create(ssa_store_t *st, const char *path,
+                     const struct ssa_store_header *hdr, const float *rates,
+                     int reopen)
+{
+    char *head;
+
+    st->hdr = *hdr;
+    st->hdr.nrows = 0;
+    st->hdr.blob_offset = align_up(data_end(&st->hdr), COLUMN_ALIGN);
+    st->hdr.blob_words = 0;
+
+    if (reopen)
+        return reopen_store(st, path);
+
+    st->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (st->fd < 0) {
+        printf("Error: Failed to create store %s\n", path);
+        return -1;
+    }
+    head = (char *) calloc(1, SSA_STORE_HEADER_SIZE);
+    memcpy(head, &st->hdr, sizeof(st->hdr));
+    if (write_at(st->fd, head, SSA_STORE_HEADER_SIZE, 0) != 0
+        || write_at(st->fd, rates, rates_size(&st->hdr), st->hdr.rates_offset) != 0
+        || ftruncate(st->fd, (off_t) st->hdr.blob_offset) != 0) {
+        printf("Error: Failed to write store %s\n", path);
+        free(head);
+        close(st->fd);
+        return -1;
+    }
+    free(head);
+    return 0;
+}
+
+int ssa_store_write(ssa_store_t *st, int col, uint64_t row,
+                    const void *data, uint64_t nrows)
+{
+    const struct ssa_store_column *c = &st->hdr.columns[col];
+    size_t row_size = ssa_store_row_size(c);
+
+    if (row + nrows > st->hdr.capacity)
+        return -1;
+    return write_at(st->fd, data, nrows * row_size, c->offset + row * row_size);
+}
+
+int ssa_store_read(ssa_store_t *st, int col, uint64_t row, void *data, uint64_t nrows)
+{
+    const struct ssa_store_column *c = &st->hdr.columns[col];
+    size_t size = nrows * ssa_store_row_size(c);
+
+    if (row + nrows > st->hdr.capacity)
+        return -1;
+    return pread(st->fd, data, size, (off_t) (c->offset + row * ssa_store_row_size(c)))
+        == (ssize_t) size ? 0 : -1;
+}
+
+int ssa_store_append(ssa_store_t *st, const uint32_t *words, uint64_t nwords,
+                     uint64_t *offset)
+{
+    *offset = st->hdr.blob_words;
+    if (write_at(st->fd, words, nwords * sizeof(uint32_t),
+                 st->hdr.blob_offset + st->hdr.blob_words * sizeof(uint32_t)) != 0)
+        return -1;
+    st->hdr.blob_words += nwords;
+    return 0;
+}
+
+int ssa_store_rewind(ssa_store_t *st, uint64_t nrows)
+{
+    uint64_t end = 0;
+
+    st->hdr.nrows = nrows;
+    for (uint32_t i = 0; i < st->hdr.ncolumns && nrows > 0; i++) {
+        struct ssa_store_packed p;
+        if (st->hdr.columns[i].type != SSA_STORE_PACKED)
+            continue;
+        if (ssa_store_read(st, (int) i, nrows - 1, &p, 1) != 0)
+            return -1;
+        if (p.offset + ssa_pack_words(st->hdr.columns[i].width, p.bits) > end)
+            end = p.offset + ssa_pack_words(st->hdr.columns[i].width, p.bits);
+    }
+    st->hdr.blob_words = end;
+    return ftruncate(st->fd, (off_t) (st->hdr.blob_offset + end * sizeof(uint32_t)));
+}
+
+int ssa_store_flush(ssa_store_t *st, uint64_t nrows)
+{
+    st->hdr.nrows = nrows;
+    return (write_at(st->fd, &st->hdr, sizeof(st->hdr), 0) == 0
+            && fsync(st->fd) == 0) ? 0 : -1;
+}
+
+int ssa_store_close(ssa_store_t *st, uint64_t nrows)
+{
+    int ok = ssa_store_flush(st, nrows) == 0;
+
+    ok = (close(st->fd) == 0) && ok;
+    return ok ? 0 : -1;
+}
+
+const struct ssa_store_header *ssa_store_map(const char *path, size_t *size)
+{
+    struct stat sb;
+    const struct ssa_store_header *hdr;
+    void *map;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        printf("Error: Failed to open store %s\n", path);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    if ((size_t) sb.st_size < SSA_STORE_HEADER_SIZE) {
+        printf("Error: %s is not a store\n", path);
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("Error: Failed to map store %s\n", path);
+        return NULL;
+    }
+    hdr = (const struct ssa_store_header *) map;
+    if (memcmp(hdr->magic, SSA_STORE_MAGIC, sizeof(hdr->magic)) != 0
+        || hdr->version != SSA_STORE_VERSION
+        || hdr->ncolumns > SSA_STORE_MAX_COLUMNS
+        || hdr->nrows > hdr->capacity
+        || hdr->blob_offset < data_end(hdr)
+        || hdr->blob_offset + hdr->blob_words * sizeof(uint32_t) > (uint64_t) sb.st_size) {
+        printf("Error: %s is not a store of this version\n", path);
+        munmap(map, (size_t) sb.st_size);
+        return NULL;
+    }
+    *size = (size_t) sb.st_size;
+    return hdr;
+}
+
+int ssa_store_find(const struct ssa_store_header *hdr, const char *name)
+{
+    for (uint32_t i = 0; i < hdr->ncolumns; i++)
+        if (strncmp(hdr->columns[i].name, name, sizeof(hdr->columns[i].name)) == 0)
+            return (int) i;
+    return -1;
+}
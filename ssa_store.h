@@ -0,0 +1,176 @@
+#ifndef SSA_STORE_H
+#define SSA_STORE_H
+/**
+ *  FILE:    ssa_store.h
+ *
+ *  SUMMARY: Columnar binary result store. A fixed header describes the
+ *           run and the columns; every column is a contiguous array of
+ *           fixed-width values (one row per trajectory), so the file can
+ *           be memory-mapped (numpy.memmap, ssa_store_map) and read
+ *           without parsing.
+ *
+ *  LAYOUT:
+ *      [0, header_size)            struct ssa_store_header
+ *      [rates_offset, ...)         rate table, nsets rows of float32
+ *                                  (2 * nchannel per row with sens)
+ *      [columns[i].offset, ...)    capacity rows of width values of
+ *                                  columns[i].type, 64-byte aligned
+ *                                  (one struct ssa_store_packed per row
+ *                                  for SSA_STORE_PACKED)
+ *      [blob_offset, ...)          blob_words 32-bit words of packed
+ *                                  time series (ssa_pack.h), appended
+ *      All values are in native (little-endian on x86) byte order.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SSA_STORE_MAGIC "SSASTORE"
+#define SSA_STORE_VERSION 2
+#define SSA_STORE_HEADER_SIZE 4096
+#define SSA_STORE_MAX_COLUMNS 32
+
+/* column value types */
+#define SSA_STORE_INT32   0
+#define SSA_STORE_FLOAT32 1
+#define SSA_STORE_UINT64  2
+#define SSA_STORE_PACKED  3     // width samples coded into the blob
+
+/* row of a SSA_STORE_PACKED column */
+struct ssa_store_packed {
+    uint64_t offset;        // first word in the blob
+    int32_t base;           // first sample
+    uint32_t bits;          // bits per difference
+};
+
+struct ssa_store_column {
+    char name[16];
+    uint32_t type;          // SSA_STORE_INT32, ...
+    uint32_t width;         // values per row (time series: samples)
+    uint64_t offset;        // file offset of row 0
+};
+
+struct ssa_store_header {
+    char magic[8];          // SSA_STORE_MAGIC, not 0-terminated
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t model_hash;    // kernel source, initial state and dimensions
+    uint64_t rates_hash;    // rate table
+    uint64_t seed;
+    uint64_t nsets;         // parameter sets
+    uint64_t nrep;          // trajectories per set
+    uint64_t first;         // first trajectory of the run
+    uint64_t capacity;      // rows reserved in every column
+    uint64_t nrows;         // rows written, in order
+    uint32_t nx;            // species
+    uint32_t nchannel;      // reaction channels
+    uint32_t nsamples;      // time series samples per trajectory
+    uint32_t ncolumns;
+    uint32_t rng;           // SSA_RNG of the run
+    uint32_t sens;          // rows are coupled pairs (--sensitivity)
+    double finaltime;       // sample k is the state at finaltime * (k+1) / nsamples
+    uint64_t rates_offset;
+    uint64_t blob_offset;   // after the last column
+    uint64_t blob_words;    // words appended to the blob
+    struct ssa_store_column columns[SSA_STORE_MAX_COLUMNS];
+};
+
+typedef struct SSA_STORE_T {
+    int fd;
+    struct ssa_store_header hdr;
+} ssa_store_t;
+
+/**
+ * Clears hdr and sets its format fields; the caller fills in the run
+ * and then adds the columns.
+ */
+void ssa_store_init(struct ssa_store_header *hdr);
+
+/**
+ * Appends a column of capacity rows of width values to hdr, after the
+ * rate table and the columns added before. Returns its index.
+ */
+int ssa_store_add_column(struct ssa_store_header *hdr, const char *name,
+                         uint32_t type, uint32_t width);
+
+/**
+ * Adds the result columns of a run in the order they are written:
+ * traj, x0.., y0.. (sens), steps, ftime and, with hdr->nsamples, the
+ * time series x0_t.. (packed with pack).
+ */
+void ssa_store_add_result_columns(struct ssa_store_header *hdr, int pack);
+
+/**
+ * Creates path with header hdr (columns added) and the rate table, and
+ * reserves the space of all columns. With reopen, the existing file
+ * of the same run (equal header) is opened for writing instead, so a
+ * resumed run continues it. Returns 0 on success, -1 on failure.
+ */
+int ssa_store_create(ssa_store_t *st, const char *path,
+                     const struct ssa_store_header *hdr, const float *rates,
+                     int reopen);
+
+/**
+ * Writes nrows rows of column col starting at row, in one write.
+ * Returns 0 on success, -1 on failure.
+ */
+int ssa_store_write(ssa_store_t *st, int col, uint64_t row,
+                    const void *data, uint64_t nrows);
+
+/**
+ * Appends nwords words to the blob in one write and returns the blob
+ * offset of the first one in offset. Returns 0 on success, -1 on failure.
+ */
+int ssa_store_append(ssa_store_t *st, const uint32_t *words, uint64_t nwords,
+                     uint64_t *offset);
+
+/**
+ * Reads nrows rows of column col starting at row.
+ * Returns 0 on success, -1 on failure.
+ */
+int ssa_store_read(ssa_store_t *st, int col, uint64_t row, void *data, uint64_t nrows);
+
+/**
+ * Continues a reopened store after its first nrows rows: the blob is
+ * cut after the words of those rows, dropping those of later rows.
+ * Returns 0 on success, -1 on failure.
+ */
+int ssa_store_rewind(ssa_store_t *st, uint64_t nrows);
+
+/**
+ * Records nrows in the header and flushes the file to disk, so the rows
+ * are readable and survive a crash. Returns 0 on success, -1 on failure.
+ */
+int ssa_store_flush(ssa_store_t *st, uint64_t nrows);
+
+/**
+ * Flushes as ssa_store_flush and closes the file.
+ * Returns 0 on success, -1 on failure.
+ */
+int ssa_store_close(ssa_store_t *st, uint64_t nrows);
+
+/**
+ * Maps path read-only and checks its header. Returns the mapping (the
+ * header is at its start) and its size, or NULL on failure.
+ */
+const struct ssa_store_header *ssa_store_map(const char *path, size_t *size);
+
+/**
+ * Returns the index of the column called name, or -1.
+ */
+int ssa_store_find(const struct ssa_store_header *hdr, const char *name);
+
+/**
+ * Size in bytes of one row of a column.
+ */
+size_t ssa_store_row_size(const struct ssa_store_column *c);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
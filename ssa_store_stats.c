@@ -0,0 +1,130 @@
+/**
+ *  FILE:    ssa_store_stats.c
+ *
+ *  SUMMARY: Summary statistics of a result store (ssa_opencl --store),
+ *           computed straight from the memory-mapped columns.
+ *
+ *  NOTES:
+ *      Rows are grouped by parameter set (traj / nrep). Scalar columns
+ *      get n, mean, sd, min and max per set; time series columns get the
+ *      mean and sd at every sample time, packed ones (--pack) decoded
+ *      from the mapped blob row by row.
+ *
+ *      >> ./ssa_store_stats results.ssa [COLUMN...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "ssa_pack.h"
+#include "ssa_stats.h"
+#include "ssa_store.h"
+
+/* the width values of row r of column c, as doubles */
+static void row_values(const struct ssa_store_header *hdr, const struct ssa_store_column *c,
+                       uint64_t r, int32_t *tmp, double *out)
+{
+    const char *p = (const char *) hdr + c->offset + r * ssa_store_row_size(c);
+
+    for (uint32_t v = 0; v < c->width && c->type != SSA_STORE_PACKED; v++) {
+        switch (c->type) {
+        case SSA_STORE_INT32:   out[v] = ((const int32_t *) p)[v]; break;
+        case SSA_STORE_FLOAT32: out[v] = ((const float *) p)[v]; break;
+        default:                out[v] = (double) ((const uint64_t *) p)[v]; break;
+        }
+    }
+    if (c->type == SSA_STORE_PACKED) {
+        const struct ssa_store_packed *pk = (const struct ssa_store_packed *) p;
+        const uint32_t *blob = (const uint32_t *) ((const char *) hdr + hdr->blob_offset);
+        ssa_unpack_row(blob + pk->offset, pk->bits, pk->base, c->width, tmp);
+        for (uint32_t v = 0; v < c->width; v++) out[v] = tmp[v];
+    }
+}
+
+static void column_stats(const struct ssa_store_header *hdr, const struct ssa_store_column *c,
+                         const uint64_t *traj)
+{
+    const size_t nstats = hdr->nsets * c->width;
+    ssa_stats_t *st = (ssa_stats_t *) malloc(sizeof(ssa_stats_t) * nstats);
+    double *lo = (double *) malloc(sizeof(double) * hdr->nsets);
+    double *hi = (double *) malloc(sizeof(double) * hdr->nsets);
+    double *row = (double *) malloc(sizeof(double) * c->width);
+    int32_t *tmp = (int32_t *) malloc(sizeof(int32_t) * c->width);
+
+    for (size_t i = 0; i < nstats; i++) ssa_stats_init(&st[i]);
+    for (uint64_t r = 0; r < hdr->nrows; r++) {
+        uint64_t set = traj[r] / hdr->nrep;
+        if (set >= hdr->nsets) continue;
+        row_values(hdr, c, r, tmp, row);
+        for (uint32_t v = 0; v < c->width; v++) {
+            double d = row[v];
+            ssa_stats_add(&st[set * c->width + v], d);
+            if (c->width == 1 && c->type != SSA_STORE_PACKED) {
+                if (st[set].n == 1 || d < lo[set]) lo[set] = d;
+                if (st[set].n == 1 || d > hi[set]) hi[set] = d;
+            }
+        }
+    }
+
+    for (uint64_t set = 0; set < hdr->nsets; set++) {
+        const ssa_stats_t *s = st + set * c->width;
+        if (s[0].n == 0) continue;
+        if (c->width == 1 && c->type != SSA_STORE_PACKED) {
+            printf("  set %llu %-6s n=%zu mean %.3f sd %.3f min %g max %g\n",
+                   (unsigned long long) set, c->name, s[0].n, s[0].mean,
+                   ssa_stats_sd(&s[0]), lo[set], hi[set]);
+            continue;
+        }
+        printf("  set %llu %-6s n=%zu, t mean/sd:\n", (unsigned long long) set, c->name, s[0].n);
+        for (uint32_t v = 0; v < c->width; v++)
+            printf("    %g %.3f/%.3f\n", hdr->finaltime * (v + 1) / c->width,
+                   s[v].mean, ssa_stats_sd(&s[v]));
+    }
+    free(st);
+    free(lo);
+    free(hi);
+    free(row);
+    free(tmp);
+}
+
+int main(int argc, char **argv)
+{
+    const struct ssa_store_header *hdr;
+    const uint64_t *traj;
+    size_t size;
+    int t;
+
+    if (argc < 2) {
+        printf("usage: %s FILE [COLUMN...]\n", argv[0]);
+        return 1;
+    }
+    hdr = ssa_store_map(argv[1], &size);
+    if (hdr == NULL)
+        return 1;
+    t = ssa_store_find(hdr, "traj");
+    if (t < 0) {
+        printf("Error: %s has no traj column\n", argv[1]);
+        return 1;
+    }
+    traj = (const uint64_t *) ((const char *) hdr + hdr->columns[t].offset);
+
+    printf("%s: %llu of %llu rows, model %016llx, seed %llu, %llu set(s) x %llu, %u samples\n",
+           argv[1], (unsigned long long) hdr->nrows, (unsigned long long) hdr->capacity,
+           (unsigned long long) hdr->model_hash, (unsigned long long) hdr->seed,
+           (unsigned long long) hdr->nsets, (unsigned long long) hdr->nrep, hdr->nsamples);
+
+    for (uint32_t i = 0; i < hdr->ncolumns; i++) {
+        const struct ssa_store_column *c = &hdr->columns[i];
+        int selected = (argc == 2);
+
+        for (int a = 2; a < argc; a++)
+            selected |= strncmp(argv[a], c->name, sizeof(c->name)) == 0;
+        if (selected && (int) i != t)
+            column_stats(hdr, c, traj);
+    }
+
+    munmap((void *) hdr, size);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/**
+ *  FILE:    ssa_sweep.c
+ *
+ *  SUMMARY: Host-side parameter sweeps: rate tables read from a file or
+ *           generated as a grid around the nominal rates.
+ *
+ *  NOTES:
+ *      Row s of a table is parameter set s. The kernel runs nrep
+ *      replicates of every set, trajectory t using set t / nrep, so the
+ *      results of a set come back as one contiguous block.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "prob_params.h"
+#include "ssa_sweep.h"
+
+struct grid_axis {
+    int channel;
+    int n;
+    double lo, hi;
+    int logscale;
+};
+
+float *ssa_sweep_load(const char *path, size_t *nsets)
+{
+    FILE *fp = fopen(path, "r");
+    char line[1024];
+    size_t n = 0, cap = 16, lineno = 0;
+    float *rates;
+
+    if (!fp) {
+        printf("Error: Failed to open sweep file %s\n", path);
+        return NULL;
+    }
+    rates = (float *) malloc(sizeof(float) * NCHANNEL * cap);
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = line, *end;
+        int c;
+
+        lineno++;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+        if (n == cap) {
+            cap *= 2;
+            rates = (float *) realloc(rates, sizeof(float) * NCHANNEL * cap);
+        }
+        for (c = 0; c < NCHANNEL; c++) {
+            while (*p == ' ' || *p == '\t' || *p == ',') p++;
+            rates[n * NCHANNEL + c] = strtof(p, &end);
+            if (end == p) break;
+            p = end;
+        }
+        if (c < NCHANNEL) {
+            printf("Error: %s:%zu: expected %d rate constants\n",
+                   path, lineno, NCHANNEL);
+            free(rates);
+            fclose(fp);
+            return NULL;
+        }
+        n++;
+    }
+    fclose(fp);
+    if (n == 0) {
+        printf("Error: No parameter sets in %s\n", path);
+        free(rates);
+        return NULL;
+    }
+    *nsets = n;
+    return rates;
+}
+
+static int parse_axis(const char *spec, struct grid_axis *axis)
+{
+    char scale[8] = "";
+    int consumed = 0;
+
+    if (sscanf(spec, "%d=%lf:%lf:%d%n", &axis->channel, &axis->lo,
+               &axis->hi, &axis->n, &consumed) != 4) {
+        return -1;
+    }
+    if (spec[consumed] == ':') {
+        if (sscanf(spec + consumed + 1, "%7s", scale) != 1
+            || strcmp(scale, "log") != 0) {
+            return -1;
+        }
+    } else if (spec[consumed] != '\0') {
+        return -1;
+    }
+    axis->logscale = (scale[0] != '\0');
+    if (axis->channel < 0 || axis->channel >= NCHANNEL || axis->n < 1) {
+        return -1;
+    }
+    if (axis->logscale && (axis->lo <= 0.0 || axis->hi <= 0.0)) {
+        return -1;
+    }
+    return 0;
+}
+
+static double axis_value(const struct grid_axis *axis, int i)
+{
+    double f = (axis->n == 1) ? 0.0 : (double) i / (axis->n - 1);
+
+    if (axis->logscale) {
+        return exp(log(axis->lo) + f * (log(axis->hi) - log(axis->lo)));
+    }
+    return axis->lo + f * (axis->hi - axis->lo);
+}
+
+float *ssa_sweep_grid(const float *nominal, char **specs, int nspecs,
+                      size_t *nsets)
+{
+    struct grid_axis *axes;
+    float *rates;
+    size_t n = 1;
+
+    axes = (struct grid_axis *) malloc(sizeof(struct grid_axis) * nspecs);
+    for (int a = 0; a < nspecs; a++) {
+        if (parse_axis(specs[a], &axes[a]) != 0) {
+            printf("Error: Bad grid axis '%s' (expected CH=LO:HI:N[:log])\n",
+                   specs[a]);
+            free(axes);
+            return NULL;
+        }
+        n *= axes[a].n;
+    }
+
+    rates = (float *) malloc(sizeof(float) * NCHANNEL * n);
+    for (size_t s = 0; s < n; s++) {
+        size_t rest = s;
+        float *row = rates + s * NCHANNEL;
+
+        memcpy(row, nominal, sizeof(float) * NCHANNEL);
+        for (int a = nspecs - 1; a >= 0; a--) {
+            row[axes[a].channel] = (float) axis_value(&axes[a],
+                                                      (int) (rest % axes[a].n));
+            rest /= axes[a].n;
+        }
+    }
+    free(axes);
+    *nsets = n;
+    return rates;
+}
@@ -0,0 +1,40 @@
+#ifndef SSA_SWEEP_H
+#define SSA_SWEEP_H
+/**
+ *  FILE:    ssa_sweep.h
+ *
+ *  SUMMARY: Host-side parameter sweeps: tables of rate-constant sets
+ *           (NCHANNEL floats each) uploaded to the kernel, so a whole
+ *           sweep runs with one program build.
+ */
+
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Reads a list of rate-constant sets from path, one set of NCHANNEL
+ * numbers per line, separated by blanks or commas. Empty lines and
+ * lines starting with '#' are skipped. Returns a malloc'ed table of
+ * (*nsets)*NCHANNEL floats, or NULL on failure.
+ */
+float *ssa_sweep_load(const char *path, size_t *nsets);
+
+/**
+ * Builds the cartesian product of nspecs grid axes around the nominal
+ * rates. Each spec is "CH=LO:HI:N" or "CH=LO:HI:N:log", giving N values
+ * of channel CH from LO to HI, evenly spaced on a linear or log scale.
+ * Channels without an axis keep their nominal rate; the first axis
+ * varies slowest. Returns a malloc'ed table of (*nsets)*NCHANNEL
+ * floats, or NULL on failure.
+ */
+float *ssa_sweep_grid(const float *nominal, char **specs, int nspecs,
+                      size_t *nsets);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ *  FILE:    ssa_tail.c
+ *
+ *  SUMMARY: Host threads finishing the straggler trajectories of a
+ *           launch (see ssa_tail.h).
+ *
+ *  NOTES:
+ *      finish_item is the loop of ssa_kernel for one launch item,
+ *      continued from the state of a slice: the same float arithmetic,
+ *      negative state check, time series samples and, through
+ *      ssa_rng_host.h, the same generator state and stream. Build with
+ *      -ffp-contract=off so the host does not fuse the propensity sums,
+ *      as ssa_kernel.cl does not (FP_CONTRACT OFF). The device's log may
+ *      still round differently from logf, so a trajectory finished here
+ *      equals its device run in distribution, not bit for bit.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ssa_rng_host.h"
+#include "ssa_checkpoint.h"
+#include "ssa_tail.h"
+
+static const int nu[NX][NCHANNEL] = {{-1, 1, 0}, {1, -1, -1}, {0, 0, 1}};   // same model as ssa_kernel
+
+/* time of time series sample k of nsamples, as ssa_sample_time */
+static float sample_time(uint32_t k, uint32_t nsamples)
+{
+    return (float)FINALTIME * (k + 1) / nsamples;
+}
+
+/* runs item i to FINALTIME; returns the steps taken */
+static uint64_t finish_item(const struct ssa_tail *t, size_t i)
+{
+    const uint64_t traj = t->traj_base + (i / t->span) * t->nrep + i % t->span;
+    const float *k = t->rates + (traj / t->nrep) * NCHANNEL;
+    int32_t *xi = t->x + i*NX;
+    float curTime = t->ftime[i];
+    int32_t counter = t->counters[i];
+    uint32_t sidx = 0;
+    uint64_t steps = 0;
+    ssa_rng_t rng;
+
+    ssa_rng_status_read(&rng, (ssa_rng_t *) t->rng, i);
+    while (sidx < t->nsamples && sample_time(sidx, t->nsamples) < curTime) sidx++;
+
+    while (curTime <= FINALTIME) {
+        float a0, a[NCHANNEL];
+        float f, jsum, tau, rand1, rexp;
+        int rxn, reverted = 0;
+
+        steps++;
+        counter++;
+        ssa_rng_draw2(&rng, &rand1, &rexp);
+
+        a[0] = xi[0]*k[0];
+        a[1] = xi[1]*k[1];
+        a[2] = xi[1]*k[2];
+        a0 = a[0] + a[1] + a[2];
+        if (a0 <= 0.0f) {
+            // absorbing state, as in ssa_kernel: the state holds to the end
+            for (; sidx < t->nsamples; sidx++)
+                for (int j=0; j<NX; j++)
+                    t->samples[((size_t)j*t->count + i)*t->nsamples + sidx] = xi[j];
+            break;
+        }
+        f = rand1 * a0;
+        jsum = 0.0;
+        for (rxn=0; jsum < f; rxn++) jsum += a[rxn];
+        rxn--;
+
+        for (int j=0; j<NX; j++) xi[j] += nu[j][rxn];
+        tau = rexp / a0;
+        curTime += tau;
+
+        for (int j=0; j<NX; j++) {
+            if (xi[j] < 0) {
+                for (int l=0; l<NX; l++) xi[l] -= nu[l][rxn];
+                curTime -= tau;
+                reverted = 1;
+                break;
+            }
+        }
+        if (!reverted) {
+            for (; sidx < t->nsamples && sample_time(sidx, t->nsamples) < curTime; sidx++)
+                for (int j=0; j<NX; j++)
+                    t->samples[((size_t)j*t->count + i)*t->nsamples + sidx] = xi[j] - nu[j][rxn];
+        }
+    }
+
+    t->ftime[i] = curTime;
+    t->counters[i] = counter;
+    t->done[i] = 1;
+    ssa_rng_status_write((ssa_rng_t *) t->rng, i, &rng);
+    return steps;
+}
+
+static void *tail_thread(void *arg)
+{
+    struct ssa_tail *t = (struct ssa_tail *) arg;
+    uint64_t steps = 0;
+    uint32_t i;
+
+    // stragglers are long, so items are taken one at a time
+    while ((i = __atomic_fetch_add(&t->next, 1, __ATOMIC_RELAXED)) < t->count) {
+        if (!t->done[i]) {
+            uint64_t s = finish_item(t, i);
+            steps += s;
+            __atomic_fetch_add(&t->finished_steps, s, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&t->finished, 1, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_fetch_add(&t->steps, steps, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+int ssa_tail_start(struct ssa_tail *tail, int nthreads)
+{
+    tail->next = 0;
+    tail->steps = 0;
+    tail->nthreads = 0;
+    tail->threads = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+    if (tail->threads == NULL)
+        return -1;
+    for (int i=0; i<nthreads; i++) {
+        if (pthread_create(&tail->threads[tail->nthreads], NULL, tail_thread, tail) == 0)
+            tail->nthreads++;
+    }
+    if (tail->nthreads == 0) {
+        free(tail->threads);
+        tail->threads = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void ssa_tail_wait(struct ssa_tail *tail)
+{
+    for (int i=0; i<tail->nthreads; i++)
+        pthread_join(tail->threads[i], NULL);
+    free(tail->threads);
+    tail->threads = NULL;
+    tail->nthreads = 0;
+}
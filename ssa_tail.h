@@ -0,0 +1,70 @@
+#ifndef SSA_TAIL_H
+#define SSA_TAIL_H
+/**
+ *  FILE:    ssa_tail.h
+ *
+ *  SUMMARY: Tail offloading: the trajectories of a launch that are still
+ *           running when most have finished are taken from the device
+ *           state and finished on host threads, so the device can run
+ *           the next launch meanwhile.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "prob_params.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*
+ * One launch of ssa_kernel, stopped between slices. The per-item arrays
+ * hold the state as the kernel left it (see ssa_kernel and
+ * ssa_checkpoint) and are finished in place.
+ */
+struct ssa_tail {
+    /* the launch */
+    const float *rates;     // NCHANNEL rate constants per set
+    uint64_t nrep;          // trajectories per set
+    uint64_t traj_base;     // trajectory of item 0
+    uint32_t span;          // consecutive replicates per set
+    uint32_t count;         // items
+    uint32_t nsamples;      // time series samples per trajectory
+
+    /* state of the count items */
+    int32_t *x;             // count * NX
+    float *ftime;           // count
+    int32_t *counters;      // count
+    int32_t *done;          // count
+    uint32_t *rng;          // count * SSA_RNG_STATE_WORDS
+    int32_t *samples;       // NX * count * nsamples, species-major
+
+    /* threads, set by ssa_tail_start */
+    int nthreads;
+    pthread_t *threads;
+    uint32_t next;          // next item to take
+    uint64_t steps;         // steps taken on the host
+    uint64_t finished;      // items finished on the host, over every start
+    uint64_t finished_steps;    // their host steps, added as each finishes
+};
+
+/**
+ * Starts nthreads threads that finish every item of tail whose done
+ * flag is not set, with the algorithm and random stream of ssa_kernel.
+ * The launch fields and arrays must be set. Returns 0, or -1 if no
+ * thread could be started.
+ */
+int ssa_tail_start(struct ssa_tail *tail, int nthreads);
+
+/**
+ * Waits until every item of tail is done and joins the threads.
+ */
+void ssa_tail_wait(struct ssa_tail *tail);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ *  FILE:    tinymt32j_states.c
+ *
+ *  SUMMARY: Host-side precomputation of the per-trajectory TinyMT32
+ *           start states, so the kernel reads one 16-byte state per
+ *           work item instead of running up to 32 jumps of 128 state
+ *           transitions each.
+ *
+ *  NOTES:
+ *      Trajectory t starts 3^40 * t steps into the stream seeded by
+ *      the run seed, the step of tinymt32_jump_table64 in
+ *      TinyMT/jump/tinymt32_jump_table64.h, which the device jumps by
+ *      as well. Each thread jumps once to the start of its block and
+ *      then walks the block with the 3^40 jump polynomial.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "tinymt32j_states.h"
+#include "ssa_checkpoint.h"
+#include "tinymt32_jump_table64.h"
+
+/* characteristic polynomial of TINYMT32J_MAT1/MAT2/TMAT */
+#define TINYMT32J_CHARACTERISTIC "d8524022ed8dff4a8dcc50c798faba43"
+#define TINYMT32J_MAGIC_STEP TINYMT32_JUMP_TABLE64_STEP       // 3^40
+
+#if TINYMT32J_MAX_TRAJ != TINYMT32_JUMP_TABLE64_MAX_ID
+#error "TINYMT32J_MAX_TRAJ does not match tinymt32_jump_table64.h"
+#endif
+
+#define STATES_FILE_MAGIC "TMT32JST"
+#define STATES_FILE_VERSION 2
+
+struct states_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t seed;
+    uint64_t first;
+    uint64_t count;
+};
+
+struct states_job {
+    uint32_t *states;
+    uint64_t seed;
+    uint64_t first;
+    size_t begin, end;
+    const f2_polynomial *step;
+};
+
+void tinymt32j_stream_start(tinymt32_t *tiny, uint64_t seed, uint64_t traj)
+{
+    uint32_t key[2] = { (uint32_t) seed, (uint32_t) (seed >> 32) };
+
+    tiny->mat1 = 0x8f7011eeU;
+    tiny->mat2 = 0xfc78ff1fU;
+    tiny->tmat = 0x3793fdffU;
+    tinymt32_init_by_array(tiny, key, 2);
+    tinymt32_jump_by_table(tiny, tinymt32_jump_table64, TINYMT32_JUMP_TABLE64_SIZE, traj);
+}
+
+void tinymt32j_stream_step(f2_polynomial *step)
+{
+    calculate_jump_polynomial(step, TINYMT32J_MAGIC_STEP, 0, TINYMT32J_CHARACTERISTIC);
+}
+
+static void *states_worker(void *arg)
+{
+    struct states_job *job = (struct states_job *) arg;
+    tinymt32_t tiny;
+
+    if (job->begin >= job->end)
+        return NULL;
+
+    // jump to the first trajectory of this block
+    tinymt32j_stream_start(&tiny, job->seed, job->first + job->begin);
+
+    for (size_t i = job->begin; i < job->end; i++) {
+        memcpy(&job->states[i * TINYMT32J_STATE_WORDS], tiny.status,
+               TINYMT32J_STATE_WORDS * sizeof(uint32_t));
+        tinymt32_jump_by_polynomial(&tiny, (f2_polynomial *) job->step);
+    }
+    return NULL;
+}
+
+static void compute_states(uint32_t *states, uint64_t seed, uint64_t first,
+                           size_t count, int nthreads)
+{
+    f2_polynomial step;
+    tinymt32j_stream_step(&step);
+
+    if (nthreads <= 0) nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0) nthreads = 1;
+    if ((size_t) nthreads > count) nthreads = count > 0 ? (int) count : 1;
+
+    pthread_t *threads = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+    int *started = (int *) calloc(nthreads, sizeof(int));
+    struct states_job *jobs = (struct states_job *) malloc(nthreads * sizeof(struct states_job));
+    size_t chunk = (count + nthreads - 1) / nthreads;
+
+    for (int t = 0; t < nthreads; t++) {
+        jobs[t].states = states;
+        jobs[t].seed = seed;
+        jobs[t].first = first;
+        jobs[t].begin = t * chunk < count ? t * chunk : count;
+        jobs[t].end = (t + 1) * chunk < count ? (t + 1) * chunk : count;
+        jobs[t].step = &step;
+        started[t] = pthread_create(&threads[t], NULL, states_worker, &jobs[t]) == 0;
+        if (!started[t])
+            states_worker(&jobs[t]);   // no more threads: do this block here
+    }
+    for (int t = 0; t < nthreads; t++)
+        if (started[t]) pthread_join(threads[t], NULL);
+
+    free(started);
+    free(jobs);
+    free(threads);
+}
+
+static void cache_path(char *path, size_t size, const char *cache_dir,
+                       uint64_t seed, uint64_t first, size_t count)
+{
+    snprintf(path, size, "%s/tinymt32j_%llu_%llu_%zu.states",
+             cache_dir, (unsigned long long) seed,
+             (unsigned long long) first, count);
+}
+
+static int read_cache(const char *path, uint32_t *states, uint64_t seed,
+                      uint64_t first, size_t count)
+{
+    struct states_file_header hdr;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return -1;
+
+    int ok = fread(&hdr, sizeof(hdr), 1, fp) == 1
+        && memcmp(hdr.magic, STATES_FILE_MAGIC, sizeof(hdr.magic)) == 0
+        && hdr.version == STATES_FILE_VERSION
+        && hdr.seed == seed
+        && hdr.first == first
+        && hdr.count == count
+        && fread(states, TINYMT32J_STATE_WORDS * sizeof(uint32_t), count, fp) == count;
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+struct cache_body {
+    struct states_file_header hdr;
+    const uint32_t *states;
+};
+
+static int write_body(FILE *fp, void *arg)
+{
+    const struct cache_body *body = (const struct cache_body *) arg;
+    size_t count = body->hdr.count;
+
+    return (fwrite(&body->hdr, sizeof(body->hdr), 1, fp) == 1
+            && fwrite(body->states, TINYMT32J_STATE_WORDS * sizeof(uint32_t), count, fp) == count)
+        ? 0 : -1;
+}
+
+static int write_cache(const char *path, const uint32_t *states, uint64_t seed,
+                       uint64_t first, size_t count)
+{
+    struct cache_body body;
+
+    memcpy(body.hdr.magic, STATES_FILE_MAGIC, sizeof(body.hdr.magic));
+    body.hdr.version = STATES_FILE_VERSION;
+    body.hdr.reserved = 0;
+    body.hdr.seed = seed;
+    body.hdr.first = first;
+    body.hdr.count = count;
+    body.states = states;
+    return ssa_write_atomic(path, write_body, &body);
+}
+
+uint32_t *tinymt32j_states_get(uint64_t seed, uint64_t first, size_t count,
+                               int nthreads, const char *cache_dir)
+{
+    char path[4096];
+    uint32_t *states = (uint32_t *) malloc(count * TINYMT32J_STATE_WORDS * sizeof(uint32_t));
+    if (states == NULL) {
+        perror("tinymt32j_states_get");
+        return NULL;
+    }
+
+    if (cache_dir == NULL) {
+        compute_states(states, seed, first, count, nthreads);
+        return states;
+    }
+
+    cache_path(path, sizeof(path), cache_dir, seed, first, count);
+    if (read_cache(path, states, seed, first, count) == 0)
+        return states;
+
+    compute_states(states, seed, first, count, nthreads);
+    if (write_cache(path, states, seed, first, count) != 0)
+        fprintf(stderr, "Warning: could not write TinyMT state cache %s\n", path);
+
+    return states;
+}
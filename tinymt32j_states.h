@@ -0,0 +1,60 @@
+#ifndef TINYMT32J_STATES_H
+#define TINYMT32J_STATES_H
+/**
+ *  FILE:    tinymt32j_states.h
+ *
+ *  SUMMARY: Host-side precomputation of the per-trajectory TinyMT32
+ *           start states used by the kernel (SSA_TINYMT_PRECOMPUTED),
+ *           built on TinyMT/jump and cached on disk.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tinymt32.h"
+#include "jump32.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* largest trajectory id whose stream ends before the TinyMT32 period,
+   TINYMT32_JUMP_TABLE64_MAX_ID of TinyMT/jump/tinymt32_jump_table64.h */
+#define TINYMT32J_MAX_TRAJ UINT64_C(13994560389365007133)
+
+/* one state is the 4 words of tinymt32j_t (s0..s3) */
+#define TINYMT32J_STATE_WORDS 4
+
+/**
+ * Returns the start states of trajectories first .. first+count-1 for
+ * the 64-bit run seed, exactly as ssa_rng_init() produces them on the
+ * device: init_by_array with the two seed words, then a jump of
+ * trajectory * 3^40 steps. The states are read from the cache file in
+ * cache_dir if one exists for (seed, first, count); otherwise they are
+ * computed with nthreads threads (0: one per online CPU) and the cache
+ * file is written. A NULL cache_dir computes without caching. Returns
+ * a malloc'ed array of count*TINYMT32J_STATE_WORDS words, or NULL on
+ * failure.
+ */
+uint32_t *tinymt32j_states_get(uint64_t seed, uint64_t first, size_t count,
+                               int nthreads, const char *cache_dir);
+
+/**
+ * Sets tiny to the start state of trajectory traj for the 64-bit run
+ * seed, the state ssa_rng_init() produces on the device. traj must not
+ * exceed TINYMT32J_MAX_TRAJ.
+ */
+void tinymt32j_stream_start(tinymt32_t *tiny, uint64_t seed, uint64_t traj);
+
+/**
+ * Computes the jump polynomial of one trajectory (3^40 steps):
+ * tinymt32_jump_by_polynomial with it moves the start state of
+ * trajectory t to the start state of trajectory t+1.
+ */
+void tinymt32j_stream_step(f2_polynomial *step);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ *  FILE:    tinymt32wp_params.c
+ *
+ *  SUMMARY: Loads the TinyMT32 parameter sets that give every trajectory
+ *           a generator of its own, so the kernel seeds each stream
+ *           with init_by_array and never jumps.
+ *
+ *  NOTES:
+ *      The text is the output of TinyMT/dc (tinymt32dc -c N id, see
+ *      TinyMT/opencl/tinymt32dc.0.2000.txt): "characteristic, type, id,
+ *      mat1, mat2, tmat, weight, delta" per line, '#' lines are comments.
+ *      Parsing a large file on every run is slow, so the sets are cached
+ *      as a binary array keyed by the name, size and modification time
+ *      of the text file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "tinymt32wp_params.h"
+#include "ssa_checkpoint.h"
+
+#define PARAMS_FILE_MAGIC "TMT32WPP"
+#define PARAMS_FILE_VERSION 1
+#define PARAMS_LINE_MAX 512
+
+struct params_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t count;
+};
+
+static const char *base_name(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static void cache_path(char *path, size_t size, const char *cache_dir, const char *source)
+{
+    snprintf(path, size, "%s/tinymt32wp_%s.params", cache_dir, base_name(source));
+}
+
+/* parses every data line; returns the number of sets or -1 on a bad line */
+static long parse_params(const char *path, uint32_t **params)
+{
+    char line[PARAMS_LINE_MAX];
+    size_t n = 0, cap = 1024;
+    long lineno = 0;
+    FILE *fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    *params = (uint32_t *) malloc(cap * TINYMT32WP_PARAM_WORDS * sizeof(uint32_t));
+    while (*params != NULL && fgets(line, sizeof(line), fp) != NULL) {
+        unsigned int type, mat1, mat2, tmat;
+
+        lineno++;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+        if (sscanf(line, "%*[^,],%u,%*u,%x,%x,%x", &type, &mat1, &mat2, &tmat) != 4
+            || type != 32) {
+            fprintf(stderr, "%s:%ld: not a tinymt32dc parameter line\n", path, lineno);
+            free(*params);
+            *params = NULL;
+            break;
+        }
+        if (n == cap) {
+            uint32_t *p;
+            cap *= 2;
+            p = (uint32_t *) realloc(*params, cap * TINYMT32WP_PARAM_WORDS * sizeof(uint32_t));
+            if (p == NULL) {
+                free(*params);
+                *params = NULL;
+                break;
+            }
+            *params = p;
+        }
+        (*params)[n*TINYMT32WP_PARAM_WORDS + 0] = mat1;
+        (*params)[n*TINYMT32WP_PARAM_WORDS + 1] = mat2;
+        (*params)[n*TINYMT32WP_PARAM_WORDS + 2] = tmat;
+        n++;
+    }
+    fclose(fp);
+    return *params ? (long) n : -1;
+}
+
+static int read_cache(const char *path, const struct stat *source, uint32_t **params,
+                      size_t *count)
+{
+    struct params_file_header hdr;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return -1;
+
+    int ok = fread(&hdr, sizeof(hdr), 1, fp) == 1
+        && memcmp(hdr.magic, PARAMS_FILE_MAGIC, sizeof(hdr.magic)) == 0
+        && hdr.version == PARAMS_FILE_VERSION
+        && hdr.source_size == (uint64_t) source->st_size
+        && hdr.source_mtime == (int64_t) source->st_mtime;
+    if (ok) {
+        *params = (uint32_t *) malloc(hdr.count * TINYMT32WP_PARAM_WORDS * sizeof(uint32_t));
+        ok = *params != NULL
+            && fread(*params, TINYMT32WP_PARAM_WORDS * sizeof(uint32_t), hdr.count, fp) == hdr.count;
+        if (!ok) {
+            free(*params);
+            *params = NULL;
+        }
+    }
+    fclose(fp);
+    if (!ok)
+        return -1;
+    *count = hdr.count;
+    return 0;
+}
+
+struct cache_body {
+    struct params_file_header hdr;
+    const uint32_t *params;
+};
+
+static int write_body(FILE *fp, void *arg)
+{
+    const struct cache_body *body = (const struct cache_body *) arg;
+    size_t count = body->hdr.count;
+
+    return (fwrite(&body->hdr, sizeof(body->hdr), 1, fp) == 1
+            && fwrite(body->params, TINYMT32WP_PARAM_WORDS * sizeof(uint32_t), count, fp) == count)
+        ? 0 : -1;
+}
+
+static int write_cache(const char *path, const struct stat *source, const uint32_t *params,
+                       size_t count)
+{
+    struct cache_body body;
+
+    memcpy(body.hdr.magic, PARAMS_FILE_MAGIC, sizeof(body.hdr.magic));
+    body.hdr.version = PARAMS_FILE_VERSION;
+    body.hdr.reserved = 0;
+    body.hdr.source_size = (uint64_t) source->st_size;
+    body.hdr.source_mtime = (int64_t) source->st_mtime;
+    body.hdr.count = count;
+    body.params = params;
+    return ssa_write_atomic(path, write_body, &body);
+}
+
+uint32_t *tinymt32wp_params_get(const char *path, const char *cache_dir, size_t *count)
+{
+    char cache[4096];
+    struct stat source;
+    uint32_t *params = NULL;
+    long n;
+
+    if (stat(path, &source) != 0) {
+        perror(path);
+        return NULL;
+    }
+
+    if (cache_dir != NULL) {
+        cache_path(cache, sizeof(cache), cache_dir, path);
+        if (read_cache(cache, &source, &params, count) == 0)
+            return params;
+    }
+
+    n = parse_params(path, &params);
+    if (n < 0)
+        return NULL;
+    *count = (size_t) n;
+
+    if (cache_dir != NULL && write_cache(cache, &source, params, *count) != 0)
+        fprintf(stderr, "Warning: could not write TinyMT parameter cache %s\n", cache);
+
+    return params;
+}
@@ -0,0 +1,36 @@
+#ifndef TINYMT32WP_PARAMS_H
+#define TINYMT32WP_PARAMS_H
+/**
+ *  FILE:    tinymt32wp_params.h
+ *
+ *  SUMMARY: Per-trajectory TinyMT32 parameter sets of the kernel
+ *           (SSA_RNG_TINYMT_WP), read from the text output of
+ *           tinymt32dc and cached on disk in binary form.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* one parameter set is mat1, mat2 and tmat of tinymt32wp_t */
+#define TINYMT32WP_PARAM_WORDS 3
+
+/**
+ * Returns the parameter sets of the tinymt32dc output file path, one per
+ * data line in file order, and their number in *count. The sets are read
+ * from the binary cache file in cache_dir if it was written from the
+ * same file (name, size and modification time); otherwise the text is
+ * parsed and the cache file is written. A NULL cache_dir parses without
+ * caching. Returns a malloc'ed array of *count*TINYMT32WP_PARAM_WORDS
+ * words, or NULL on failure.
+ */
+uint32_t *tinymt32wp_params_get(const char *path, const char *cache_dir, size_t *count);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif